@@ -22,96 +22,336 @@
  * - I2C Specification used: I2C Bus specification, version 6.0, April 2014
  * - Here is the latest I2C specification by the creator (NXP) - 2021 version: https://www.nxp.com/docs/en/user-guide/UM10204.pdf
  * 
+ * This file only talks to the RTC through the transaction layer (no peripheral access), so it also builds on the 
+ * host against DS1307_Mock.c - see DS1307_HAL.h and test/.
 */
 
 #include <stdio.h>
 #include <string.h>
-#include "pico/stdlib.h"
-#include "pico/binary_info.h"
-#include "hardware/regs/resets.h"
-#include "hardware/address_mapped.h"
-#include "hardware/resets.h"
-#include "hardware/i2c.h"
-#include "hardware/clocks.h"
+#include "DS1307_HAL.h"
 #include "DS1307.h"
 #include "I2C_Driver.h"
+#include "DS1307_Log.h"
+
+/** Register shadowing - the driver keeps a copy of the bits it owns, so bit-level updates are one write, no read first:
+ *  - Control register (07h): fully known once read or written - OUT/SQWE/RS changes are a single write, 
+ *    a change to the current value costs nothing.
+ *  - CH bit (00h bit 7) and, while the oscillator is halted, the seconds too (they don't count then) - enabling a 
+ *    halted oscillator is a single write with the shadowed seconds. Halting a running one still has to read the 
+ *    seconds first (they keep changing), unless the shadow already says it is halted.
+ *  - 12/24-hour mode bit (02h bit 6) - learned from every timekeeper read/write.
+ *  The shadow is filled by DS1307_Dev_LoadShadow() (one 8 byte burst read of 00h-07h), done automatically on first 
+ *  use, and updated by every DS1307_Dev_ function. Writes that bypass them (I2C_Register_Write(), a power loss on 
+ *  the RTC...) require DS1307_Dev_InvalidateShadow().
+ *  DS1307_SHADOW_VERIFY = 1 reads back every shadowed write and fails (and invalidates the shadow) on a mismatch.
+ *  The DS1307 address is fixed, so there is one RTC per bus - the shadows are kept per bus.
+*/
+typedef struct
+{
+	const I2C_Bus_t *bus;		/* NULL - slot unused */
+	bool controlValid;
+	bool timekeeperValid;
+	uint8_t control;			/* 07h */
+	uint8_t seconds;			/* 00h incl. CH - the seconds part only meaningful while CH = 1 */
+	bool mode12h;				/* 02h bit 6 */
+} DS1307_Shadow_t;
+
+static DS1307_Shadow_t shadows[DS1307_SHADOW_BUS_COUNT];
+
+static DS1307_Shadow_t *DS1307_GetShadow(const I2C_Device_t *rtc)
+{
+	DS1307_Shadow_t *freeSlot = NULL;
+
+	for(uint32_t i = 0; i < DS1307_SHADOW_BUS_COUNT; i++)
+	{
+		if(shadows[i].bus == rtc->bus)
+		{
+			return &shadows[i];
+		}
+		if((shadows[i].bus == NULL) && (freeSlot == NULL))
+		{
+			freeSlot = &shadows[i];
+		}
+	}
+	if(freeSlot != NULL)
+	{
+		freeSlot->bus = rtc->bus;
+		freeSlot->controlValid = false;
+		freeSlot->timekeeperValid = false;
+	}
+	return freeSlot; /* NULL - more buses than slots, no shadowing for this one */
+}
+
+/* Take note of timekeeper registers read from or written to the RTC (at least 00h-02h) */
+static void DS1307_Shadow_Observe(const I2C_Device_t *rtc, const uint8_t *timekeeperRegs)
+{
+	DS1307_Shadow_t *shadow = DS1307_GetShadow(rtc);
+
+	if(shadow != NULL)
+	{
+		shadow->seconds = timekeeperRegs[0];
+		shadow->mode12h = (timekeeperRegs[2] & HOURS_12H_MODE_BIT) != 0;
+		shadow->timekeeperValid = true;
+	}
+}
+
+void DS1307_Dev_InvalidateShadow(I2C_Device_t *rtc)
+{
+	DS1307_Shadow_t *shadow = DS1307_GetShadow(rtc);
+
+	if(shadow != NULL)
+	{
+		shadow->controlValid = false;
+		shadow->timekeeperValid = false;
+	}
+}
+
+uint8_t DS1307_Dev_LoadShadow(I2C_Device_t *rtc)
+{
+	uint8_t regs_au8[DS1307_REG_CONTROL + 1]; /* 00h-07h */
+	DS1307_Shadow_t *shadow = DS1307_GetShadow(rtc);
+
+	if(shadow == NULL)
+	{
+		return STAUS_FAILURE;
+	}
+	if(I2C_Dev_Burst_Read(rtc, DS1307_REG_SECONDS, regs_au8, sizeof(regs_au8)) != STATUS_SUCCESS)
+	{
+		DS1307_Dev_InvalidateShadow(rtc);
+		return MPU6050_REGISTER_I2C_READ_FAIL;
+	}
 
-#define PRINTS_ENABLED 1
+	DS1307_Shadow_Observe(rtc, regs_au8);
+	shadow->control = regs_au8[DS1307_REG_CONTROL];
+	shadow->controlValid = true;
 
-#if(PRINTS_ENABLED == 1)
-#define LOG(...) printf(__VA_ARGS__)
-#else
-#define LOG(...) 
+	return STATUS_SUCCESS;
+}
+
+/* Register write of a shadowed register - read back and compared with DS1307_SHADOW_VERIFY */
+static uint8_t DS1307_Shadow_Write(I2C_Device_t *rtc, uint8_t registerAddress, uint8_t value)
+{
+	if(I2C_Dev_Register_Write(rtc, registerAddress, value) != STATUS_SUCCESS)
+	{
+		DS1307_Dev_InvalidateShadow(rtc);
+		return MPU6050_REGISTER_I2C_READ_FAIL;
+	}
+
+#if DS1307_SHADOW_VERIFY
+	uint8_t readBack = I2C_Dev_Register_Read(rtc, registerAddress);
+	/* Seconds may have counted on since the write if the oscillator runs - only the CH bit is compared then */
+	uint8_t compareMask = ((registerAddress == DS1307_REG_SECONDS) && !(value & CH_BIT_REG_0_READ_MASK)) ? 
+						  CH_BIT_REG_0_READ_MASK : 0xFF;
+	if((readBack & compareMask) != (value & compareMask))
+	{
+		LOG_WARN("DS1307 register 0x%x verify failed: wrote 0x%x, read 0x%x \n", registerAddress, value, readBack);
+		DS1307_Dev_InvalidateShadow(rtc);
+		return STAUS_FAILURE;
+	}
 #endif
 
-uint8_t Disable_DS1307_SquareWaveOutput() 
+	return STATUS_SUCCESS;
+}
+
+/* Write the whole control register (07h) - no I2C traffic if it already holds 'value' */
+uint8_t DS1307_Dev_SetControl(I2C_Device_t *rtc, uint8_t value)
 {
-	size_t length;
-	uint32_t errorCount = 0;
-	const uint32_t maxRetries = 5;
-	const uint32_t retryDelayUs = 5;
+	DS1307_Shadow_t *shadow = DS1307_GetShadow(rtc);
 
-	printf("Current DS1307 SQW Status = %x \n", I2C_Register_Read(0x07));
-	printf("Disabling the SQW by setting the control register (0x07) to 0x2... \n");
-    uint8_t outputData_Reset[] = {0x07, 0x02};
-	length = sizeof(outputData_Reset);
-	while(!i2c_write_blocking(i2c_default, DS1307_I2C_ADDRESS, outputData_Reset, length, false))
+	if((shadow != NULL) && shadow->controlValid && (shadow->control == value))
+	{
+		return STATUS_SUCCESS;
+	}
+	if(DS1307_Shadow_Write(rtc, DS1307_REG_CONTROL, value) != STATUS_SUCCESS)
+	{
+		return MPU6050_REGISTER_I2C_READ_FAIL;
+	}
+	if(shadow != NULL)
 	{
-		printf("I2C write transaction failed. Retrying... "); /* Data not acknowledged by slave (or some other error) */
+		shadow->control = value;
+		shadow->controlValid = true;
+	}
+
+	LOG_DEBUG("DS1307 control register = %x \n", value);
+	return STATUS_SUCCESS;
+}
 
-		sleep_us(retryDelayUs);
-		errorCount++;
-		if(errorCount > maxRetries)
+/* Modify bits of the control register without reading it first (once the shadow is loaded) */
+static uint8_t DS1307_Dev_UpdateControl(I2C_Device_t *rtc, uint8_t clearMask, uint8_t setBits)
+{
+	DS1307_Shadow_t *shadow = DS1307_GetShadow(rtc);
+
+	if((shadow == NULL) || !shadow->controlValid)
+	{
+		uint8_t control = I2C_Dev_Register_Read(rtc, DS1307_REG_CONTROL);
+		if(I2C_Bus_GetLastError(rtc->bus, NULL) != I2C_ERROR_NONE)
 		{
 			return MPU6050_REGISTER_I2C_READ_FAIL;
 		}
+		if(shadow == NULL)
+		{
+			return DS1307_Shadow_Write(rtc, DS1307_REG_CONTROL, (control & ~clearMask) | setBits);
+		}
+		shadow->control = control;
+		shadow->controlValid = true;
+	}
+
+	return DS1307_Dev_SetControl(rtc, (shadow->control & ~clearMask) | setBits);
+}
+
+uint8_t Disable_DS1307_SquareWaveOutput() 
+{
+	LOG_DEBUG("Disabling the SQW by setting the control register (0x07) to 0x2... \n");
+	if(DS1307_Dev_SetControl(&I2C_DefaultDevice, 0x02) != STATUS_SUCCESS)
+	{
+		return MPU6050_REGISTER_I2C_READ_FAIL;
 	}
 
-	printf("Current DS1307 SQW Status = %x \n", I2C_Register_Read(0x07));
-	printf("SQW disabled \n");
+	LOG_INFO("SQW disabled \n");
 
 	return STATUS_SUCCESS;
 }
 
+/** Control register (07h): SQWE (bit 4) enables the square wave on the SQW/OUT pin, RS1:RS0 select its 
+ *  frequency (1Hz, 4.096kHz, 8.192kHz or 32.768kHz). The pin is open drain - it needs a pull-up.
+*/
+uint8_t DS1307_Dev_EnableSquareWaveOutput(I2C_Device_t *rtc, uint8_t rateSelect) 
+{
+	return DS1307_Dev_SetControl(rtc, CONTROL_REG_SQWE_BIT | (rateSelect & CONTROL_REG_RS_MASK));
+}
+
+uint8_t Enable_DS1307_SquareWaveOutput(uint8_t rateSelect) 
+{
+	return DS1307_Dev_EnableSquareWaveOutput(&I2C_DefaultDevice, rateSelect);
+}
+
+/* SQW/OUT as a static output (SQWE = 0, level by the OUT bit) - keeps the rate select bits */
+uint8_t DS1307_Dev_SetOutputLevel(I2C_Device_t *rtc, bool high)
+{
+	return DS1307_Dev_UpdateControl(rtc, CONTROL_REG_SQWE_BIT | CONTROL_REG_OUT_BIT, high ? CONTROL_REG_OUT_BIT : 0);
+}
+
 /** Bit 7 of Register 0 is the clock halt (CH) bit. When this bit is set to 1, the oscillator is disabled. 
  * When cleared to 0, the oscillator is enabled. On first application of power to the device the time and 
  * date registers are typically reset to 01/01/00 01 00:00:00 (MM/DD/YY DOW HH:MM:SS). 
  * The CH bit in the seconds register will be set to a 1. The clock can be halted 
  * whenever the timekeeping functions are not required, which minimizes current (IBATDR). 
 */
-uint8_t Enable_DS1307_Oscillator() 
+uint8_t DS1307_Dev_EnableOscillator(I2C_Device_t *rtc) 
 {
-	size_t length;
-	uint32_t errorCount = 0;
-	const uint32_t maxRetries = 5;
-	const uint32_t retryDelayUs = 5;
+	DS1307_Shadow_t *shadow = DS1307_GetShadow(rtc);
+	uint8_t reg0_Val;
 
-	uint8_t reg0_Val = I2C_Register_Read(0x00);
-	printf("Current Oscillator Status (1 disabled, 0 enabled) = %x \n", reg0_Val & CH_BIT_REG_0_READ_MASK);
-	printf("Enabling the Oscillator by clearing CH bit in reg 0x0... \n");
-    uint8_t outputData_Reset[] = {0x00, (reg0_Val & CH_BIT_REG_0_CLEAR_MASK)};
-	length = sizeof(outputData_Reset);
-	while(!i2c_write_blocking(i2c_default, DS1307_I2C_ADDRESS, outputData_Reset, length, false))
+	if((shadow != NULL) && !shadow->timekeeperValid)
 	{
-		printf("I2C write transaction failed. Retrying...  \n"); /* Data not acknowledged by slave (or some other error) */
+		(void)DS1307_Dev_LoadShadow(rtc);
+	}
 
-		sleep_us(retryDelayUs);
-		errorCount++;
-		if(errorCount > maxRetries)
+	if((shadow != NULL) && shadow->timekeeperValid)
+	{
+		if(!(shadow->seconds & CH_BIT_REG_0_READ_MASK))
+		{
+			LOG_DEBUG("Oscillator already enabled \n");
+			return STATUS_SUCCESS;
+		}
+		reg0_Val = shadow->seconds; /* Halted - the seconds haven't changed since the shadow was taken */
+	}
+	else
+	{
+		reg0_Val = I2C_Dev_Register_Read(rtc, DS1307_REG_SECONDS);
+		if(reg0_Val == MPU6050_REGISTER_I2C_READ_FAIL) /* 0xFF is not a valid seconds value (max 0xD9 with CH set) */
 		{
 			return MPU6050_REGISTER_I2C_READ_FAIL;
 		}
 	}
 
-	printf("Current Oscillator Status = %x \n", I2C_Register_Read(0x00));
-	printf("Oscillator enabled \n");
+	LOG_DEBUG("Enabling the Oscillator by clearing CH bit in reg 0x0... \n");
+	if(DS1307_Shadow_Write(rtc, DS1307_REG_SECONDS, reg0_Val & CH_BIT_REG_0_CLEAR_MASK) != STATUS_SUCCESS)
+	{
+		return MPU6050_REGISTER_I2C_READ_FAIL;
+	}
+	if(shadow != NULL)
+	{
+		shadow->seconds = reg0_Val & CH_BIT_REG_0_CLEAR_MASK;
+	}
 
-	/* Give the DS1307 a sec to start up */
-	sleep_ms(2000); 
+	LOG_INFO("Oscillator enabled \n");
 
+	/* No fixed start-up delay here - DS1307_Dev_WaitOscillatorReady() (DS1307_Oscillator.h) waits until it ticks */
 	return STATUS_SUCCESS;
 }
 
+/* CH bit state from the shadow (read from the RTC if the shadow isn't loaded) */
+uint8_t DS1307_Dev_IsOscillatorHalted(I2C_Device_t *rtc, bool *halted)
+{
+	DS1307_Shadow_t *shadow = DS1307_GetShadow(rtc);
+
+	if((shadow != NULL) && (shadow->timekeeperValid || (DS1307_Dev_LoadShadow(rtc) == STATUS_SUCCESS)))
+	{
+		*halted = (shadow->seconds & CH_BIT_REG_0_READ_MASK) != 0;
+		return STATUS_SUCCESS;
+	}
+
+	uint8_t reg0_Val = I2C_Dev_Register_Read(rtc, DS1307_REG_SECONDS);
+	if(reg0_Val == MPU6050_REGISTER_I2C_READ_FAIL)
+	{
+		return MPU6050_REGISTER_I2C_READ_FAIL;
+	}
+	*halted = (reg0_Val & CH_BIT_REG_0_READ_MASK) != 0;
+	return STATUS_SUCCESS;
+}
+
+/* Control register (07h) value from the shadow (read from the RTC if the shadow isn't loaded) */
+uint8_t DS1307_Dev_GetControl(I2C_Device_t *rtc, uint8_t *value)
+{
+	DS1307_Shadow_t *shadow = DS1307_GetShadow(rtc);
+
+	if((shadow != NULL) && (shadow->controlValid || (DS1307_Dev_LoadShadow(rtc) == STATUS_SUCCESS)))
+	{
+		*value = shadow->control;
+		return STATUS_SUCCESS;
+	}
+
+	*value = I2C_Dev_Register_Read(rtc, DS1307_REG_CONTROL);
+	return (I2C_Bus_GetLastError(rtc->bus, NULL) == I2C_ERROR_NONE) ? STATUS_SUCCESS : MPU6050_REGISTER_I2C_READ_FAIL;
+}
+
+/* Stop the clock (minimum battery current) - the time is kept and continues from there when re-enabled */
+uint8_t DS1307_Dev_HaltOscillator(I2C_Device_t *rtc)
+{
+	DS1307_Shadow_t *shadow = DS1307_GetShadow(rtc);
+
+	if((shadow != NULL) && shadow->timekeeperValid && (shadow->seconds & CH_BIT_REG_0_READ_MASK))
+	{
+		return STATUS_SUCCESS;
+	}
+
+	/* Running - the seconds have to be read, they are rewritten together with the CH bit */
+	uint8_t reg0_Val = I2C_Dev_Register_Read(rtc, DS1307_REG_SECONDS);
+	if(reg0_Val == MPU6050_REGISTER_I2C_READ_FAIL)
+	{
+		return MPU6050_REGISTER_I2C_READ_FAIL;
+	}
+	if(DS1307_Shadow_Write(rtc, DS1307_REG_SECONDS, reg0_Val | CH_BIT_REG_0_READ_MASK) != STATUS_SUCCESS)
+	{
+		return MPU6050_REGISTER_I2C_READ_FAIL;
+	}
+	if(shadow != NULL)
+	{
+		shadow->seconds = reg0_Val | CH_BIT_REG_0_READ_MASK;
+	}
+
+	return STATUS_SUCCESS;
+}
+
+/* 02h bit 6 as last seen by the driver (false also if never read) - no I2C traffic */
+bool DS1307_Dev_Is12HourMode(I2C_Device_t *rtc)
+{
+	DS1307_Shadow_t *shadow = DS1307_GetShadow(rtc);
+
+	return (shadow != NULL) && shadow->timekeeperValid && shadow->mode12h;
+}
+
 int getMonthNumber(const char *monthAbbreviation) 
 {
     const char *months[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
@@ -130,17 +370,18 @@ int getMonthNumber(const char *monthAbbreviation)
     return INCORRECT_MONTH;  /* Return error value if the abbreviation is not found */
 }
 
+/* Kept for compatibility - new code should use DS1307_BcdToDec()/DS1307_DecToBcd() from DS1307.h */
 uint8_t ConvertBCD(uint16_t valueToConvert, bool direction)
 {
 	uint8_t convertedValue;
 
 	if(direction == DEC_TO_BCD)
 	{
-		convertedValue = ((((valueToConvert-(valueToConvert%10))/10) << 4) | ((valueToConvert%10)));
+		convertedValue = DS1307_DecToBcd((uint8_t)valueToConvert);
 	}
 	else if(direction == BCD_TO_DEC)
 	{
-		convertedValue = ((((uint8_t)(valueToConvert >> 4))*10) + ((uint8_t)(valueToConvert & LOWER_NIBBLE_MASK)));
+		convertedValue = DS1307_BcdToDec((uint8_t)valueToConvert);
 	}
 	else
 	{
@@ -150,14 +391,11 @@ uint8_t ConvertBCD(uint16_t valueToConvert, bool direction)
 	return convertedValue;
 }
 
-/* Refer to Table 2. Timekeeper Registers in Datasheet to understand where the time is stored and how it's represented */
+/* Refer to Table 2. Timekeeper Registers in Datasheet to understand where the time is stored and how it's represented
+ * Parses the date/time strings at runtime - to set the build time prefer DS1307_SetBuildDateTime() (DS1307_BuildTime.h),
+ * which does the same at compile time without pulling sscanf into the image. */
 uint8_t SetCurrentDate(const char *buildDate, const char *buildTime) 
 {
-	size_t length;
-	uint32_t errorCount = 0;
-	const uint32_t maxRetries = 5;
-	const uint32_t retryDelayUs = 5;
-	uint8_t output[2];
 	char monthAbbrev[4];
     int day, month, year, hours, minutes, seconds;
     
@@ -170,7 +408,7 @@ uint8_t SetCurrentDate(const char *buildDate, const char *buildTime)
     month = getMonthNumber(monthAbbrev);
     if (month == INCORRECT_MONTH) 
 	{
-		printf("ERROR - MONTH_NUMBER = %u \n", month);
+		LOG_ERROR("ERROR - MONTH_NUMBER = %u \n", month);
 		sleep_ms(1000);
         return STAUS_FAILURE;
     }
@@ -179,7 +417,7 @@ uint8_t SetCurrentDate(const char *buildDate, const char *buildTime)
 								(uint8_t)seconds, 
 								(uint8_t)minutes, 
 								(uint8_t)hours, 
-								(uint8_t)0x1, /* Day of the week - I don't care about it right now */ 
+								DS1307_DayOfWeek((uint8_t)year, (uint8_t)month, (uint8_t)day),
 								(uint8_t)day, 
 								(uint8_t)month, 
 								(uint8_t)year
@@ -188,84 +426,404 @@ uint8_t SetCurrentDate(const char *buildDate, const char *buildTime)
 	/* Convert the values into BCD (Binary-Coded Decimal) format that DS1307 uses */
 	for(uint8_t i=0; i<sizeof(timeAndDate_au8); i++)
 	{
-		timeAndDate_au8[i] = ConvertBCD(timeAndDate_au8[i], DEC_TO_BCD);
+		timeAndDate_au8[i] = DS1307_DecToBcd(timeAndDate_au8[i]);
 	}	
 	
-	printf("Setting current date, which is: \n");
-	printf("Build Time: %x:%x:%x \n Build Date: %x/%x/%x\n", timeAndDate_au8[2], timeAndDate_au8[1], timeAndDate_au8[0],
+	LOG_INFO("Setting current date, which is: \n");
+	LOG_INFO("Build Time: %x:%x:%x \n Build Date: %x/%x/%x\n", timeAndDate_au8[2], timeAndDate_au8[1], timeAndDate_au8[0],
 														  	 timeAndDate_au8[4], timeAndDate_au8[5], timeAndDate_au8[6]);
 
-    for(int reg = 0x0; reg <= 0x6; reg++) 
-	{ 
-		output[0] = reg;
-		output[1] = timeAndDate_au8[reg];
-		length = sizeof(output);
-        while(!i2c_write_blocking(i2c_default, DS1307_I2C_ADDRESS, output, length, false))
-		{
-			printf("I2C write transaction failed. Retrying...  \n"); /* Data not acknowledged by slave (or some other error) */
-
-			sleep_us(retryDelayUs);
-			errorCount++;
-			if(errorCount > maxRetries)
-			{
-				return MPU6050_REGISTER_I2C_READ_FAIL;
-			}
-		}
-		sleep_ms(200);
-    }
+	/* Write all 7 registers in one burst - the seconds counter restarts together with the rest of the date */
+	if(DS1307_Dev_WriteTimekeeperRegs(&I2C_DefaultDevice, timeAndDate_au8) != STATUS_SUCCESS)
+	{
+		return MPU6050_REGISTER_I2C_READ_FAIL;
+	}
 
-	printf("Date set \n");
-	sleep_ms(200); 
+	LOG_INFO("Date set \n");
 
 	return STATUS_SUCCESS;
 }
 
-int setupPinsI2C0()
+/** Read the whole timekeeper block (00h-06h) with a single burst read and decode it.
+ *  Reading all registers in one transaction is ~6x faster than reading them one by one and 
+ *  the values can't tear across a seconds rollover (the DS1307 latches the time on START).
+*/
+uint8_t DS1307_Dev_ReadDateTime(I2C_Device_t *rtc, DS1307_DateTime_t *dateTime)
 {
-	/* Configure I2C pins */
-    gpio_set_function(PICO_DEFAULT_I2C_SDA_PIN, GPIO_FUNC_I2C);
-    gpio_set_function(PICO_DEFAULT_I2C_SCL_PIN, GPIO_FUNC_I2C);
-    gpio_pull_up(PICO_DEFAULT_I2C_SDA_PIN);
-    gpio_pull_up(PICO_DEFAULT_I2C_SCL_PIN);
+	uint8_t timekeeperRegs_au8[DS1307_TIMEKEEPER_REGS_LENGTH];
 
-    /* Make the I2C pins available to picotool */
-    bi_decl(bi_2pins_with_func(PICO_DEFAULT_I2C_SDA_PIN, PICO_DEFAULT_I2C_SCL_PIN, GPIO_FUNC_I2C));
+	if(I2C_Dev_Burst_Read(rtc, DS1307_REG_SECONDS, timekeeperRegs_au8, sizeof(timekeeperRegs_au8)) != STATUS_SUCCESS)
+	{
+		return MPU6050_REGISTER_I2C_READ_FAIL;
+	}
+
+	DS1307_Shadow_Observe(rtc, timekeeperRegs_au8);
+	DS1307_DecodeDateTime(timekeeperRegs_au8, dateTime);
 
 	return STATUS_SUCCESS;
 }
 
-/* Example of use:
-int main() 
+uint8_t DS1307_ReadDateTime(DS1307_DateTime_t *dateTime)
+{
+	return DS1307_Dev_ReadDateTime(&I2C_DefaultDevice, dateTime);
+}
+
+/* Decode a raw timekeeper block (00h-06h), e.g. one received by an asynchronous (DMA) transfer. Hours are 0-23 in both modes */
+void DS1307_DecodeDateTime(const uint8_t *timekeeperRegs, DS1307_DateTime_t *dateTime)
+{
+	dateTime->seconds   = DS1307_Reg_Seconds(timekeeperRegs);
+	dateTime->minutes   = DS1307_Reg_Minutes(timekeeperRegs);
+	dateTime->hours     = DS1307_Reg_Hours24(timekeeperRegs);
+	dateTime->dayOfWeek = DS1307_Reg_DayOfWeek(timekeeperRegs);
+	dateTime->date      = DS1307_Reg_Date(timekeeperRegs);
+	dateTime->month     = DS1307_Reg_Month(timekeeperRegs);
+	dateTime->year      = DS1307_Reg_Year(timekeeperRegs);
+}
+
+/* Range check of decoded values, including the length of the month */
+bool DS1307_IsValidDateTime(const DS1307_DateTime_t *dateTime)
 {
-    stdio_init_all();
+	bool valid = (dateTime->seconds < 60) & (dateTime->minutes < 60) & (dateTime->hours < 24) & 
+				 ((uint8_t)(dateTime->dayOfWeek - 1) < 7) & ((uint8_t)(dateTime->month - 1) < 12) & 
+				 (dateTime->year < 100) & (dateTime->date >= 1);
+
+	return valid && (dateTime->date <= DS1307_DaysInMonth(dateTime->month, dateTime->year));
+}
+
+/** Same as DS1307_DecodeDateTime(), but fails (STAUS_FAILURE) on a block that isn't a valid time: non-BCD digits 
+ *  (a bus glitch, an uninitialized RTC after the backup battery ran out), values out of range or a 
+ *  12-hour mode hour outside 1-12. 'dateTime' is filled in either case.
+*/
+uint8_t DS1307_DecodeDateTimeValidated(const uint8_t *timekeeperRegs, DS1307_DateTime_t *dateTime)
+{
+	uint32_t badDigits = 0;
+	uint8_t hourDigits = timekeeperRegs[2] & (DS1307_Reg_Is12HourMode(timekeeperRegs) ? HOURS_12H_MODE_MASK : HOURS_24H_MODE_MASK);
+
+	/* A BCD digit above 9 - adding 6 carries out of the nibble - checked for all digits at once */
+	for(uint8_t i = 0; i < DS1307_TIMEKEEPER_REGS_LENGTH; i++)
+	{
+		uint8_t digits = (i == 0) ? (timekeeperRegs[0] & CH_BIT_REG_0_CLEAR_MASK) : ((i == 2) ? hourDigits : timekeeperRegs[i]);
+		badDigits |= (((digits & LOWER_NIBBLE_MASK) + 6u) & 0x10u) | (((digits >> 4) + 6u) & 0x10u);
+	}
+
+	DS1307_DecodeDateTime(timekeeperRegs, dateTime);
+
+	if(DS1307_Reg_Is12HourMode(timekeeperRegs))
+	{
+		uint8_t hours12 = DS1307_BcdToDec(hourDigits);
+		badDigits |= (hours12 < 1) | (hours12 > 12);
+	}
 
-	// Reset the I2C0 controller to get a fresh clear state 
-	Reset_I2C0();
-    // Initial Configuration of the I2C0 
-    I2C_Initialize(I2C_FAST_MODE);
+	return ((badDigits == 0) && DS1307_IsValidDateTime(dateTime)) ? STATUS_SUCCESS : STAUS_FAILURE;
+}
 
-	(void)setupPinsI2C0();
-	(void)Disable_DS1307_SquareWaveOutput();
-	(void)Enable_DS1307_Oscillator();
-	(void)SetCurrentDate();
+/** Switch the hours register between 12-hour (AM/PM) and 24-hour mode, keeping the current hour.
+ *  Needs a read of 02h (the hour changes by itself) - skipped if the shadow already shows the requested mode.
+ *  Note: DS1307_WriteDateTime() and the other time setters write 24-hour mode.
+*/
+uint8_t DS1307_Dev_SetHourMode(I2C_Device_t *rtc, bool mode12h)
+{
+	DS1307_Shadow_t *shadow = DS1307_GetShadow(rtc);
+	uint8_t regs_au8[3];
 
-    while (1) 
-    {
-		printf("Going into I2C reg read... \n");
-		for(int i = 0; i<=7; i++)
+	if((shadow != NULL) && shadow->timekeeperValid && (shadow->mode12h == mode12h))
+	{
+		return STATUS_SUCCESS;
+	}
+
+	/* Read 00h-02h - the shadow gets the CH bit as well */
+	if(I2C_Dev_Burst_Read(rtc, DS1307_REG_SECONDS, regs_au8, sizeof(regs_au8)) != STATUS_SUCCESS)
+	{
+		return MPU6050_REGISTER_I2C_READ_FAIL;
+	}
+	if(DS1307_Reg_Is12HourMode(regs_au8) != mode12h)
+	{
+		uint8_t hours24 = DS1307_Reg_Hours24(regs_au8);
+		regs_au8[2] = mode12h ? DS1307_EncodeHours12(hours24) : DS1307_DecToBcd(hours24);
+		if(DS1307_Shadow_Write(rtc, 0x02, regs_au8[2]) != STATUS_SUCCESS)
 		{
-			LOG("Read reg %x = 0x%x \n", i, I2C_Register_Read(i));
+			return MPU6050_REGISTER_I2C_READ_FAIL;
 		}
-		sleep_ms(1000);
-    }
+	}
+
+	DS1307_Shadow_Observe(rtc, regs_au8);
+	return STATUS_SUCCESS;
+}
+
+/* Burst write of a raw, already BCD encoded timekeeper block (00h-06h) - keeps the register shadow in sync */
+uint8_t DS1307_Dev_WriteTimekeeperRegs(I2C_Device_t *rtc, const uint8_t *timekeeperRegs)
+{
+	if(I2C_Dev_Burst_Write(rtc, DS1307_REG_SECONDS, timekeeperRegs, DS1307_TIMEKEEPER_REGS_LENGTH) != STATUS_SUCCESS)
+	{
+		DS1307_Dev_InvalidateShadow(rtc);
+		return MPU6050_REGISTER_I2C_READ_FAIL;
+	}
+
+	DS1307_Shadow_Observe(rtc, timekeeperRegs);
+	return STATUS_SUCCESS;
+}
+
+/** Write the whole timekeeper block (00h-06h) with a single burst write. 
+ *  Note: the CH bit is written as 0, so the oscillator keeps (or starts) running. 
+*/
+uint8_t DS1307_Dev_WriteDateTime(I2C_Device_t *rtc, const DS1307_DateTime_t *dateTime)
+{
+	const uint8_t timekeeperRegs_au8[DS1307_TIMEKEEPER_REGS_LENGTH] = {
+								DS1307_DecToBcd(dateTime->seconds),
+								DS1307_DecToBcd(dateTime->minutes),
+								DS1307_DecToBcd(dateTime->hours),
+								DS1307_DecToBcd(dateTime->dayOfWeek),
+								DS1307_DecToBcd(dateTime->date),
+								DS1307_DecToBcd(dateTime->month),
+								DS1307_DecToBcd(dateTime->year)
+								};
+
+	return DS1307_Dev_WriteTimekeeperRegs(rtc, timekeeperRegs_au8);
+}
+
+uint8_t DS1307_WriteDateTime(const DS1307_DateTime_t *dateTime)
+{
+	return DS1307_Dev_WriteDateTime(&I2C_DefaultDevice, dateTime);
+}
+
+/** Battery-backed NV SRAM (08h-3Fh). 'offset' is relative to the start of the RAM (0-55).
+ *  The whole requested range is moved in one transaction using the auto-incrementing register pointer.
+*/
+uint8_t DS1307_Dev_NVRAM_Read(I2C_Device_t *rtc, uint8_t offset, uint8_t *buffer, size_t length)
+{
+	if((length == 0) || (((size_t)offset + length) > DS1307_NVRAM_SIZE))
+	{
+		return STAUS_FAILURE;
+	}
+
+	return I2C_Dev_Burst_Read(rtc, DS1307_NVRAM_START + offset, buffer, length);
+}
+
+uint8_t DS1307_Dev_NVRAM_Write(I2C_Device_t *rtc, uint8_t offset, const uint8_t *data, size_t length)
+{
+	if((length == 0) || (((size_t)offset + length) > DS1307_NVRAM_SIZE))
+	{
+		return STAUS_FAILURE;
+	}
+
+	return I2C_Dev_Burst_Write(rtc, DS1307_NVRAM_START + offset, data, length);
+}
+
+uint8_t DS1307_NVRAM_Read(uint8_t offset, uint8_t *buffer, size_t length)
+{
+	return DS1307_Dev_NVRAM_Read(&I2C_DefaultDevice, offset, buffer, length);
+}
+
+uint8_t DS1307_NVRAM_Write(uint8_t offset, const uint8_t *data, size_t length)
+{
+	return DS1307_Dev_NVRAM_Write(&I2C_DefaultDevice, offset, data, length);
+}
+
+/* Years 00-99 are 2000-2099, so every year divisible by 4 is a leap year (same rule the DS1307 uses) */
+uint8_t DS1307_DaysInMonth(uint8_t month, uint8_t year)
+{
+	static const uint8_t daysInMonth[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
 
-    return 0;
+	if((month < 1) || (month > 12))
+	{
+		return INCORRECT_MONTH;
+	}
+	if((month == 2) && ((year & 0x3) == 0))
+	{
+		return 29;
+	}
+	return daysInMonth[month - 1];
 }
+
+/** Calendar <-> day number arithmetic (days-from-civil / civil-from-days).
+ *  Years are counted from March, so the leap day is the last day of the year and the month lengths 
+ *  follow a fixed pattern: day of the year = (153 * month + 2) / 5, month 0 = March. 
+ *  The DS1307 calendar covers 2000-2099 where the 4-year rule is exact, so the day number counts whole 4-year 
+ *  cycles (1461 days) from 1996-03-01, and every division is by a constant - done as a multiply-shift, 
+ *  each verified exhaustively over its input range for 2000-2099 (the M0+ has no divide instruction).
+ *  Only the seconds -> days split needs a 32x32->64 bit multiply, all others fit in 32 bits.
 */
+#define DS1307_CYCLE_BASE_YEAR		1996u /* March-based 4-year cycles start at 1996-03-01 */
+#define DS1307_DAYS_CYCLE_TO_2000	1401u /* 1996-03-01 to 2000-01-01 */
+#define DS1307_EPOCH_2000			946684800u /* 2000-01-01 00:00:00 in Unix time */
+#define DS1307_SECONDS_PER_DAY		86400u
+
+#define DIV5(x)		(((uint32_t)(x) * 1639u) >> 13)		/* x <= 1685 */
+#define DIV153(x)	(((uint32_t)(x) * 857u) >> 17)		/* x <= 1827 */
+#define DIV365(x)	(((uint32_t)(x) * 1437u) >> 19)		/* x <= 1461 */
+#define DIV1461(x)	(((uint32_t)(x) * 22967u) >> 25)	/* x <= 37926 */
+#define DIV7(x)		(((uint32_t)(x) * 18725u) >> 17)	/* x <= 36537 */
+#define DIV60(x)	(((uint32_t)(x) * 2185u) >> 17)		/* x <= 3599 */
+#define DIV3600(x)	(((uint32_t)(x) * 37283u) >> 27)	/* x <= 86399 */
+#define DIV86400(x)	((uint32_t)(((uint64_t)(x) * 3257812231u) >> 48)) /* x <= 3155759999 (2099-12-31 23:59:59) */
+
+/* Days since 2000-01-01 */
+static uint32_t DS1307_DaysSince2000(uint8_t year, uint8_t month, uint8_t date)
+{
+	uint32_t isJanFeb = (month <= 2);
+	uint32_t yearOfCycles = (2000u + year - isJanFeb) - DS1307_CYCLE_BASE_YEAR;
+	uint32_t marchMonth = month + (isJanFeb * 12u) - 3u; /* 0 - March ... 11 - February */
+	uint32_t dayOfYear = DIV5((153u * marchMonth) + 2u) + date - 1u;
+
+	return (yearOfCycles * 365u) + (yearOfCycles >> 2) + dayOfYear - DS1307_DAYS_CYCLE_TO_2000;
+}
+
+/* 1 - Sunday ... 7 - Saturday (same convention as DS1307_BuildTime.h), 2000-01-01 was a Saturday */
+static uint8_t DS1307_DayOfWeekFromDays(uint32_t daysSince2000)
+{
+	uint32_t shiftedDays = daysSince2000 + 6u;
+
+	return (uint8_t)((shiftedDays - (DIV7(shiftedDays) * 7u)) + 1u);
+}
+
+uint8_t DS1307_DayOfWeek(uint8_t year, uint8_t month, uint8_t date)
+{
+	return DS1307_DayOfWeekFromDays(DS1307_DaysSince2000(year, month, date));
+}
+
+/* Seconds since 2000-01-01 00:00:00 (the DS1307 calendar covers 2000-2099) */
+uint32_t DS1307_ToSecondsSince2000(const DS1307_DateTime_t *dateTime)
+{
+	uint32_t days = DS1307_DaysSince2000(dateTime->year, dateTime->month, dateTime->date);
+
+	return (days * DS1307_SECONDS_PER_DAY) + (dateTime->hours * 3600u) + (dateTime->minutes * 60u) + dateTime->seconds;
+}
+
+/* Inverse of DS1307_ToSecondsSince2000(), also fills in the day of the week. Valid up to 2099-12-31 23:59:59 */
+void DS1307_FromSecondsSince2000(uint32_t secondsSince2000, DS1307_DateTime_t *dateTime)
+{
+	uint32_t days = DIV86400(secondsSince2000);
+	uint32_t secondOfDay = secondsSince2000 - (days * DS1307_SECONDS_PER_DAY);
+
+	uint32_t dayOfCycles = days + DS1307_DAYS_CYCLE_TO_2000;
+	uint32_t cycle = DIV1461(dayOfCycles);
+	uint32_t dayOfCycle = dayOfCycles - (cycle * 1461u);
+	uint32_t yearOfCycle = DIV365(dayOfCycle - (dayOfCycle == 1460u)); /* The leap day belongs to the 4th year */
+	uint32_t dayOfYear = dayOfCycle - (yearOfCycle * 365u);
+	uint32_t marchMonth = DIV153((5u * dayOfYear) + 2u);
+	uint32_t isJanFeb = (marchMonth >= 10u);
+
+	dateTime->date = (uint8_t)(dayOfYear - DIV5((153u * marchMonth) + 2u) + 1u);
+	dateTime->month = (uint8_t)(marchMonth + 3u - (isJanFeb * 12u));
+	dateTime->year = (uint8_t)((DS1307_CYCLE_BASE_YEAR - 2000u) + (cycle << 2) + yearOfCycle + isJanFeb);
+	dateTime->dayOfWeek = DS1307_DayOfWeekFromDays(days);
+
+	dateTime->hours = (uint8_t)DIV3600(secondOfDay);
+	secondOfDay -= dateTime->hours * 3600u;
+	dateTime->minutes = (uint8_t)DIV60(secondOfDay);
+	dateTime->seconds = (uint8_t)(secondOfDay - (dateTime->minutes * 60u));
+}
+
+/* Unix time (seconds since 1970-01-01 00:00:00 UTC, if the RTC runs on UTC) - fits in 32 bits up to 2106 */
+uint32_t DS1307_ToEpoch(const DS1307_DateTime_t *dateTime)
+{
+	return DS1307_EPOCH_2000 + DS1307_ToSecondsSince2000(dateTime);
+}
+
+/* Fails for times the DS1307 can't represent (before 2000 or after 2099) */
+uint8_t DS1307_FromEpoch(uint32_t epochSeconds, DS1307_DateTime_t *dateTime)
+{
+	if((epochSeconds < DS1307_EPOCH_2000) || 
+	   ((epochSeconds - DS1307_EPOCH_2000) >= (DS1307_DaysSince2000(99, 12, 31) + 1u) * DS1307_SECONDS_PER_DAY))
+	{
+		return STAUS_FAILURE;
+	}
+
+	DS1307_FromSecondsSince2000(epochSeconds - DS1307_EPOCH_2000, dateTime);
+
+	return STATUS_SUCCESS;
+}
+
+/** Packed timestamp - seconds since 2000-01-01 00:00:00 in a uint32_t, for records that store a time per entry.
+ *  Decoded straight from the raw register block (no DS1307_DateTime_t in between), 
+ *  ordered like the time itself (compare/subtract timestamps as integers) and 4 bytes instead of 7.
+*/
+DS1307_Timestamp_t DS1307_TimestampFromRegs(const uint8_t *timekeeperRegs)
+{
+	uint32_t days = DS1307_DaysSince2000(DS1307_Reg_Year(timekeeperRegs), 
+										 DS1307_Reg_Month(timekeeperRegs), 
+										 DS1307_Reg_Date(timekeeperRegs));
+
+	return (days * DS1307_SECONDS_PER_DAY) + 
+		   (DS1307_Reg_Hours24(timekeeperRegs) * 3600u) + 
+		   (DS1307_Reg_Minutes(timekeeperRegs) * 60u) + 
+		   DS1307_Reg_Seconds(timekeeperRegs);
+}
+
+/* Encode a timestamp as a ready to burst-write timekeeper block (CH bit clear, 24h mode) */
+void DS1307_TimestampToRegs(DS1307_Timestamp_t timestamp, uint8_t *timekeeperRegs)
+{
+	DS1307_DateTime_t dateTime;
+
+	DS1307_FromSecondsSince2000(timestamp, &dateTime);
+
+	timekeeperRegs[0] = DS1307_DecToBcd(dateTime.seconds);
+	timekeeperRegs[1] = DS1307_DecToBcd(dateTime.minutes);
+	timekeeperRegs[2] = DS1307_DecToBcd(dateTime.hours);
+	timekeeperRegs[3] = DS1307_DecToBcd(dateTime.dayOfWeek);
+	timekeeperRegs[4] = DS1307_DecToBcd(dateTime.date);
+	timekeeperRegs[5] = DS1307_DecToBcd(dateTime.month);
+	timekeeperRegs[6] = DS1307_DecToBcd(dateTime.year);
+}
+
+/* Fixed little-endian byte order, so records are portable whatever the reader's architecture */
+void DS1307_TimestampStore(DS1307_Timestamp_t timestamp, uint8_t *bytes)
+{
+	bytes[0] = (uint8_t)timestamp;
+	bytes[1] = (uint8_t)(timestamp >> 8);
+	bytes[2] = (uint8_t)(timestamp >> 16);
+	bytes[3] = (uint8_t)(timestamp >> 24);
+}
+
+DS1307_Timestamp_t DS1307_TimestampLoad(const uint8_t *bytes)
+{
+	return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+uint8_t DS1307_Dev_ReadTimestamp(I2C_Device_t *rtc, DS1307_Timestamp_t *timestamp)
+{
+	uint8_t timekeeperRegs_au8[DS1307_TIMEKEEPER_REGS_LENGTH];
+
+	if(I2C_Dev_Burst_Read(rtc, DS1307_REG_SECONDS, timekeeperRegs_au8, sizeof(timekeeperRegs_au8)) != STATUS_SUCCESS)
+	{
+		return MPU6050_REGISTER_I2C_READ_FAIL;
+	}
+
+	*timestamp = DS1307_TimestampFromRegs(timekeeperRegs_au8);
+
+	return STATUS_SUCCESS;
+}
+
+uint8_t DS1307_ReadTimestamp(DS1307_Timestamp_t *timestamp)
+{
+	return DS1307_Dev_ReadTimestamp(&I2C_DefaultDevice, timestamp);
+}
+
+/* Advance the date/time by one second, rolling over minutes, hours, days, months and years like the DS1307 does */
+void DS1307_AddSecond(DS1307_DateTime_t *dateTime)
+{
+	if(++dateTime->seconds < 60) return;
+	dateTime->seconds = 0;
+	if(++dateTime->minutes < 60) return;
+	dateTime->minutes = 0;
+	if(++dateTime->hours < 24) return;
+	dateTime->hours = 0;
+
+	dateTime->dayOfWeek = (dateTime->dayOfWeek >= 7) ? 1 : (dateTime->dayOfWeek + 1);
+	if(++dateTime->date <= DS1307_DaysInMonth(dateTime->month, dateTime->year)) return;
+	dateTime->date = 1;
+	if(++dateTime->month <= 12) return;
+	dateTime->month = 1;
+	dateTime->year = (dateTime->year >= 99) ? 0 : (dateTime->year + 1);
+}
+
+/* Example of use: examples/DS1307_Benchmark.c (DS1307_BENCHMARK target) - brings up the bus and the RTC and exercises every access path */
 
 /** TODO:
  * - i2c_write_blocking function was still writing/reading via I2C even when I completely disconnected RTC module! This should not be! 
  * Find out if there is an issue with their I2C driver or maybe I misinterpreted something! If its the driver, write a better one and share with
  * the community! 
  * - Add error handling everywhere
+ * (Update: all transfers now go through the transaction layer (I2C_Transaction.c, I2C_Driver.c) - own register-level transfers with 
+ * deadlines, abort source decoding and bus recovery, the SDK blocking calls are no longer used)
 */
\ No newline at end of file
@@ -0,0 +1,267 @@
+/**
+ * Software alarms keyed on RTC time - the DS1307 has no hardware alarm.
+ * 
+ * How it works:
+ * - Alarms live in a fixed pool and a binary min-heap of pool indices ordered by due time (seconds since 2000).
+ *   Free pool slots are kept on a stack, so adding/cancelling an alarm is O(log n), checking for due alarms is 
+ *   O(1) (a look at the heap top).
+ * - The time comes from the cached clock (DS1307_Clock.c): DS1307_Alarm_Start() hooks DS1307_Alarm_Tick() into 
+ *   its SQW tick, so there is no I2C traffic at all. All alarms due at or before the current second fire 
+ *   (also after a resync stepped the clock forward). Periodic alarms are re-inserted at due + period.
+ * - Callbacks run from the SQW interrupt. Add/Cancel may be called from callbacks and from thread context.
+ *   The slot (id) of a one-shot alarm is only freed once its callback returned, so an alarm added meanwhile 
+ *   (by the callback or another interrupt) never gets the id of the one that is still firing.
+*/
+
+#include "DS1307_HAL.h"
+#include "DS1307.h"
+#include "DS1307_Alarm.h"
+#include "DS1307_Clock.h"
+#include "I2C_Driver.h"
+
+typedef struct
+{
+	uint32_t dueSeconds;
+	uint32_t periodSeconds;
+	DS1307_AlarmCallback_t callback;
+	void *context;
+	int32_t heapIndex;	/* Position in the heap or DS1307_ALARM_SLOT_FREE/DS1307_ALARM_SLOT_FIRING */
+} DS1307_AlarmEntry_t;
+
+#define DS1307_ALARM_SLOT_FREE		(-1)
+#define DS1307_ALARM_SLOT_FIRING	(-2) /* One-shot alarm out of the heap, callback still running */
+
+static DS1307_AlarmEntry_t alarmPool[DS1307_ALARM_MAX_COUNT];
+static uint16_t alarmHeap[DS1307_ALARM_MAX_COUNT]; /* Pool indices, heap ordered by dueSeconds */
+static uint32_t heapSize = 0;
+static uint16_t freeSlots[DS1307_ALARM_MAX_COUNT]; /* Stack of free pool indices */
+static uint32_t freeCount = 0;
+static bool poolInitialized = false;
+
+static void DS1307_Alarm_InitPool()
+{
+	for(uint32_t i = 0; i < DS1307_ALARM_MAX_COUNT; i++)
+	{
+		alarmPool[i].heapIndex = DS1307_ALARM_SLOT_FREE;
+		freeSlots[i] = (uint16_t)(DS1307_ALARM_MAX_COUNT - 1 - i); /* Slot 0 on top */
+	}
+	freeCount = DS1307_ALARM_MAX_COUNT;
+	heapSize = 0;
+	poolInitialized = true;
+}
+
+/* Return a pool slot to the free stack - interrupts must be disabled */
+static void DS1307_Alarm_FreeSlot(uint16_t poolIndex)
+{
+	alarmPool[poolIndex].heapIndex = DS1307_ALARM_SLOT_FREE;
+	freeSlots[freeCount++] = poolIndex;
+}
+
+static bool DS1307_Alarm_Earlier(uint32_t heapA, uint32_t heapB)
+{
+	return alarmPool[alarmHeap[heapA]].dueSeconds < alarmPool[alarmHeap[heapB]].dueSeconds;
+}
+
+static void DS1307_Alarm_Swap(uint32_t heapA, uint32_t heapB)
+{
+	uint16_t poolIndex = alarmHeap[heapA];
+
+	alarmHeap[heapA] = alarmHeap[heapB];
+	alarmHeap[heapB] = poolIndex;
+	alarmPool[alarmHeap[heapA]].heapIndex = (int32_t)heapA;
+	alarmPool[alarmHeap[heapB]].heapIndex = (int32_t)heapB;
+}
+
+static void DS1307_Alarm_SiftUp(uint32_t index)
+{
+	while(index > 0)
+	{
+		uint32_t parent = (index - 1) / 2;
+		if(!DS1307_Alarm_Earlier(index, parent))
+		{
+			break;
+		}
+		DS1307_Alarm_Swap(index, parent);
+		index = parent;
+	}
+}
+
+static void DS1307_Alarm_SiftDown(uint32_t index)
+{
+	while(true)
+	{
+		uint32_t left = (2 * index) + 1;
+		uint32_t right = left + 1;
+		uint32_t smallest = index;
+
+		if((left < heapSize) && DS1307_Alarm_Earlier(left, smallest))
+		{
+			smallest = left;
+		}
+		if((right < heapSize) && DS1307_Alarm_Earlier(right, smallest))
+		{
+			smallest = right;
+		}
+		if(smallest == index)
+		{
+			break;
+		}
+		DS1307_Alarm_Swap(index, smallest);
+		index = smallest;
+	}
+}
+
+/* Insert an allocated pool entry into the heap - interrupts must be disabled */
+static void DS1307_Alarm_HeapInsert(uint16_t poolIndex)
+{
+	alarmHeap[heapSize] = poolIndex;
+	alarmPool[poolIndex].heapIndex = (int32_t)heapSize;
+	heapSize++;
+	DS1307_Alarm_SiftUp(heapSize - 1);
+}
+
+/* Remove the heap element at 'index' (its slot is not freed) - interrupts must be disabled */
+static void DS1307_Alarm_HeapRemove(uint32_t index)
+{
+	uint16_t poolIndex = alarmHeap[index];
+
+	heapSize--;
+	if(index != heapSize)
+	{
+		alarmHeap[index] = alarmHeap[heapSize];
+		alarmPool[alarmHeap[index]].heapIndex = (int32_t)index;
+		DS1307_Alarm_SiftDown(index);
+		DS1307_Alarm_SiftUp(index);
+	}
+	alarmPool[poolIndex].heapIndex = DS1307_ALARM_SLOT_FIRING;
+}
+
+/* Call after DS1307_Clock_Start() - from now on every SQW tick checks the alarms */
+void DS1307_Alarm_Start()
+{
+	if(!poolInitialized)
+	{
+		DS1307_Alarm_InitPool();
+	}
+	DS1307_Clock_SetTickHook(DS1307_Alarm_Tick);
+}
+
+void DS1307_Alarm_Stop()
+{
+	DS1307_Clock_SetTickHook(NULL);
+}
+
+/* Returns the alarm id (to cancel it) or DS1307_ALARM_INVALID_ID if all slots are used */
+int32_t DS1307_Alarm_Add(uint32_t dueSecondsSince2000, uint32_t periodSeconds, DS1307_AlarmCallback_t callback, void *context)
+{
+	int32_t alarmId = DS1307_ALARM_INVALID_ID;
+
+	if(callback == NULL)
+	{
+		return DS1307_ALARM_INVALID_ID;
+	}
+
+	uint32_t interruptState = save_and_disable_interrupts();
+
+	if(!poolInitialized)
+	{
+		DS1307_Alarm_InitPool();
+	}
+
+	if(freeCount > 0)
+	{
+		uint16_t poolIndex = freeSlots[--freeCount];
+
+		alarmPool[poolIndex].dueSeconds = dueSecondsSince2000;
+		alarmPool[poolIndex].periodSeconds = periodSeconds;
+		alarmPool[poolIndex].callback = callback;
+		alarmPool[poolIndex].context = context;
+		DS1307_Alarm_HeapInsert(poolIndex);
+		alarmId = (int32_t)poolIndex;
+	}
+
+	restore_interrupts(interruptState);
+
+	return alarmId;
+}
+
+int32_t DS1307_Alarm_AddAt(const DS1307_DateTime_t *dueDateTime, uint32_t periodSeconds, DS1307_AlarmCallback_t callback, void *context)
+{
+	return DS1307_Alarm_Add(DS1307_ToSecondsSince2000(dueDateTime), periodSeconds, callback, context);
+}
+
+/* Relative to the cached clock time */
+int32_t DS1307_Alarm_AddIn(uint32_t delaySeconds, uint32_t periodSeconds, DS1307_AlarmCallback_t callback, void *context)
+{
+	return DS1307_Alarm_Add(DS1307_Clock_GetSeconds() + delaySeconds, periodSeconds, callback, context);
+}
+
+uint8_t DS1307_Alarm_Cancel(int32_t alarmId)
+{
+	uint8_t status = STAUS_FAILURE;
+
+	if((alarmId < 0) || (alarmId >= DS1307_ALARM_MAX_COUNT) || !poolInitialized)
+	{
+		return STAUS_FAILURE;
+	}
+
+	uint32_t interruptState = save_and_disable_interrupts();
+	if(alarmPool[alarmId].heapIndex >= 0)
+	{
+		DS1307_Alarm_HeapRemove((uint32_t)alarmPool[alarmId].heapIndex);
+		DS1307_Alarm_FreeSlot((uint16_t)alarmId);
+		status = STATUS_SUCCESS;
+	}
+	restore_interrupts(interruptState);
+
+	return status;
+}
+
+/* Fire everything due at or before 'secondsSince2000' - called from the clock tick (or manually) */
+void DS1307_Alarm_Tick(uint32_t secondsSince2000)
+{
+	while(true)
+	{
+		uint32_t interruptState = save_and_disable_interrupts();
+
+		if((heapSize == 0) || (alarmPool[alarmHeap[0]].dueSeconds > secondsSince2000))
+		{
+			restore_interrupts(interruptState);
+			break;
+		}
+
+		uint16_t poolIndex = alarmHeap[0];
+		DS1307_AlarmEntry_t *entry = &alarmPool[poolIndex];
+		DS1307_AlarmCallback_t callback = entry->callback;
+		void *context = entry->context;
+		bool oneShot = (entry->periodSeconds == DS1307_ALARM_ONE_SHOT);
+
+		DS1307_Alarm_HeapRemove(0);
+		if(!oneShot)
+		{
+			/* Skip the periods missed by a clock step, a periodic alarm fires once per tick at most */
+			do
+			{
+				entry->dueSeconds += entry->periodSeconds;
+			} while(entry->dueSeconds <= secondsSince2000);
+			DS1307_Alarm_HeapInsert(poolIndex);
+		}
+
+		restore_interrupts(interruptState);
+
+		callback((int32_t)poolIndex, secondsSince2000, context);
+
+		if(oneShot)
+		{
+			interruptState = save_and_disable_interrupts();
+			DS1307_Alarm_FreeSlot(poolIndex);
+			restore_interrupts(interruptState);
+		}
+	}
+}
+
+/* Number of scheduled alarms */
+uint32_t DS1307_Alarm_Count()
+{
+	return heapSize;
+}
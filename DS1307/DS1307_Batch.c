@@ -0,0 +1,181 @@
+/**
+ * Coalesced reads across the whole register map. The DS1307 registers 00h-3Fh (time, control, NVRAM) are one 
+ * address space with an auto-incrementing pointer that wraps from 3Fh to 00h, so any set of ranges can be 
+ * read with few sequential burst reads - e.g. the time (00h-06h) and a counter at the end of the NVRAM 
+ * (3Ch-3Fh) are one 11 byte read starting at 3Ch and wrapping to 00h.
+ * 
+ * - The requested registers are collected in a 64-bit map.
+ * - The reads start right after the largest run of unrequested registers (going around the wrap point), 
+ *   so the rest of the map is covered with as few bytes as possible.
+ * - Runs separated by at most DS1307_BATCH_MERGE_GAP unrequested registers are merged into one transfer.
+ * - Everything is read into a map sized scratch buffer and copied out to the requested buffers.
+ * The DS1307 latches the timekeeper registers at the START of a read - a batch read in one transfer can't 
+ * tear across a seconds rollover either.
+*/
+
+#include <string.h>
+#include "DS1307.h"
+#include "DS1307_Batch.h"
+#include "I2C_Driver.h"
+
+#define REGISTER_INDEX_MASK (DS1307_REGISTER_MAP_SIZE - 1)
+
+static bool DS1307_Batch_IsRequested(uint64_t requestedMap, uint32_t reg)
+{
+	return (requestedMap >> (reg & REGISTER_INDEX_MASK)) & 1u;
+}
+
+/* First register after the largest circular run of unrequested registers */
+static uint32_t DS1307_Batch_FindStart(uint64_t requestedMap)
+{
+	uint32_t bestStart = 0;
+	uint32_t bestGap = 0;
+	uint32_t gap = 0;
+
+	/* Two rounds, so a gap across the wrap point is measured in one piece */
+	for(uint32_t reg = 0; reg < (2 * DS1307_REGISTER_MAP_SIZE); reg++)
+	{
+		if(!DS1307_Batch_IsRequested(requestedMap, reg))
+		{
+			gap++;
+			continue;
+		}
+		if(gap > bestGap)
+		{
+			bestGap = gap;
+			bestStart = reg & REGISTER_INDEX_MASK;
+		}
+		gap = 0;
+	}
+	return bestStart;
+}
+
+/** Read all 'ranges' with the least transactions (one when the gaps are small). 
+ *  Ranges may overlap and be in any order. Fails before any transfer if the ranges span more than 
+ *  DS1307_BATCH_MAX_TRANSFERS separate transfers.
+*/
+uint8_t DS1307_Dev_BatchRead(I2C_Device_t *rtc, const DS1307_BatchRange_t *ranges, size_t rangeCount)
+{
+	uint8_t map_au8[DS1307_REGISTER_MAP_SIZE];
+	uint8_t transferStart[DS1307_BATCH_MAX_TRANSFERS];
+	uint8_t transferLength[DS1307_BATCH_MAX_TRANSFERS];
+	uint32_t transferCount = 0;
+	uint64_t requestedMap = 0;
+
+	for(size_t i = 0; i < rangeCount; i++)
+	{
+		if((ranges[i].length == 0) || (ranges[i].length > DS1307_REGISTER_MAP_SIZE))
+		{
+			return STAUS_FAILURE;
+		}
+		for(uint32_t reg = ranges[i].startRegister; reg < (uint32_t)(ranges[i].startRegister + ranges[i].length); reg++)
+		{
+			requestedMap |= (uint64_t)1 << (reg & REGISTER_INDEX_MASK);
+		}
+	}
+	if(requestedMap == 0)
+	{
+		return STATUS_SUCCESS;
+	}
+
+	/* Plan the transfers - walk the map once from the start point, merging across small gaps */
+	uint32_t start = DS1307_Batch_FindStart(requestedMap);
+	uint32_t offset = 0;
+	while(offset < DS1307_REGISTER_MAP_SIZE)
+	{
+		if(!DS1307_Batch_IsRequested(requestedMap, start + offset))
+		{
+			offset++;
+			continue;
+		}
+
+		uint32_t runStart = offset;
+		uint32_t runEnd = offset + 1; /* Exclusive */
+		uint32_t scan = runEnd;
+		while(scan < DS1307_REGISTER_MAP_SIZE)
+		{
+			if(DS1307_Batch_IsRequested(requestedMap, start + scan))
+			{
+				runEnd = ++scan;
+			}
+			else if((scan - runEnd) < DS1307_BATCH_MERGE_GAP)
+			{
+				scan++;
+			}
+			else
+			{
+				break;
+			}
+		}
+
+		if(transferCount == DS1307_BATCH_MAX_TRANSFERS)
+		{
+			return STAUS_FAILURE;
+		}
+		transferStart[transferCount] = (uint8_t)((start + runStart) & REGISTER_INDEX_MASK);
+		transferLength[transferCount] = (uint8_t)(runEnd - runStart);
+		transferCount++;
+		offset = runEnd;
+	}
+
+	/* A transfer may run past 3Fh - the pointer wraps, continue filling the map at 00h */
+	for(uint32_t i = 0; i < transferCount; i++)
+	{
+		uint8_t first = transferStart[i];
+		uint8_t beforeWrap = (uint8_t)(DS1307_REGISTER_MAP_SIZE - first);
+		uint8_t readBuffer_au8[DS1307_REGISTER_MAP_SIZE];
+
+		if(I2C_Dev_Burst_Read(rtc, first, readBuffer_au8, transferLength[i]) != STATUS_SUCCESS)
+		{
+			return MPU6050_REGISTER_I2C_READ_FAIL;
+		}
+		if(transferLength[i] <= beforeWrap)
+		{
+			memcpy(&map_au8[first], readBuffer_au8, transferLength[i]);
+		}
+		else
+		{
+			memcpy(&map_au8[first], readBuffer_au8, beforeWrap);
+			memcpy(&map_au8[0], &readBuffer_au8[beforeWrap], transferLength[i] - beforeWrap);
+		}
+	}
+
+	for(size_t i = 0; i < rangeCount; i++)
+	{
+		for(uint32_t j = 0; j < ranges[i].length; j++)
+		{
+			ranges[i].buffer[j] = map_au8[(ranges[i].startRegister + j) & REGISTER_INDEX_MASK];
+		}
+	}
+
+	return STATUS_SUCCESS;
+}
+
+uint8_t DS1307_BatchRead(const DS1307_BatchRange_t *ranges, size_t rangeCount)
+{
+	return DS1307_Dev_BatchRead(&I2C_DefaultDevice, ranges, rangeCount);
+}
+
+/* The time plus an NVRAM block ('nvramOffset' relative to 08h) - one transaction when they are close or wrap */
+uint8_t DS1307_Dev_ReadDateTimeAndNVRAM(I2C_Device_t *rtc, DS1307_DateTime_t *dateTime, uint8_t nvramOffset, uint8_t *nvramBuffer, size_t nvramLength)
+{
+	uint8_t timekeeperRegs_au8[DS1307_TIMEKEEPER_REGS_LENGTH];
+
+	if((nvramLength == 0) || ((nvramOffset + nvramLength) > DS1307_NVRAM_SIZE))
+	{
+		return STAUS_FAILURE;
+	}
+
+	const DS1307_BatchRange_t ranges[] = {
+		{ .startRegister = DS1307_REG_SECONDS, .length = DS1307_TIMEKEEPER_REGS_LENGTH, .buffer = timekeeperRegs_au8 },
+		{ .startRegister = (uint8_t)(DS1307_NVRAM_START + nvramOffset), .length = (uint8_t)nvramLength, .buffer = nvramBuffer }
+	};
+
+	if(DS1307_Dev_BatchRead(rtc, ranges, sizeof(ranges) / sizeof(ranges[0])) != STATUS_SUCCESS)
+	{
+		return MPU6050_REGISTER_I2C_READ_FAIL;
+	}
+
+	DS1307_DecodeDateTime(timekeeperRegs_au8, dateTime);
+	return STATUS_SUCCESS;
+}
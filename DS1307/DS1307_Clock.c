@@ -0,0 +1,283 @@
+/**
+ * Cached software clock - keeps a RAM shadow of the DS1307 date/time so reading the time costs a few memory loads
+ * instead of an I2C round trip.
+ * 
+ * How it works:
+ * - The DS1307 SQW/OUT pin is configured for 1Hz and connected to a GPIO (open drain - pull-up enabled on the GPIO).
+ *   The seconds register of the DS1307 is updated on the falling edge of the 1Hz output, so each falling edge 
+ *   advances the shadow by one second (from the GPIO interrupt).
+ * - Every 'resyncIntervalSeconds' the shadow is refreshed from the DS1307 with a single burst read. The I2C transfer
+ *   is not done in the interrupt - DS1307_Clock_Service() has to be called periodically from thread context.
+ * - The shadow is published with a sequence counter (odd while an update is in progress), so readers never take a 
+ *   lock or disable interrupts - they just retry in the unlikely case an edge arrived during the copy.
+ * - The RP2040 microsecond timer is latched at every edge, so DS1307_Clock_GetTimestampUs() can return the RTC seconds 
+ *   plus the microseconds elapsed since the last edge - microsecond resolution wall time without any I2C traffic.
+ *   The sub-second part is clamped below 1s, so the timestamp stays monotonic even if an edge is serviced late. 
+ *   Until the first edge after DS1307_Clock_Start() the sub-second part is only approximate.
+*/
+
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+#include "DS1307.h"
+#include "DS1307_Clock.h"
+#include "I2C_Driver.h"
+
+typedef struct
+{
+	DS1307_DateTime_t dateTime;
+	uint32_t secondsSince2000;
+	uint64_t edgeTimeUs;	/* time_us_64() latched at the SQW edge that started the current second */
+} DS1307_ClockShadow_t;
+
+static volatile DS1307_ClockShadow_t shadow;
+static volatile uint32_t shadowSequence = 0;
+static volatile uint32_t tickCount = 0;
+static volatile bool resyncPending = false;
+static DS1307_ClockTickHook_t tickHook = NULL;
+static uint32_t clockSqwGpio;
+static uint32_t clockResyncInterval;
+static uint32_t lastResyncTick;
+static bool clockRunning = false;
+
+/* Drift correction (see DS1307_Clock_SetTrim()) - changed rarely, read under disabled interrupts */
+static uint64_t trimAnchorUs = 0;
+static int64_t trimOffsetUs = 0;
+static int32_t trimDriftPpb = 0;
+
+static void DS1307_Clock_Publish(const DS1307_ClockShadow_t *newShadow)
+{
+	shadowSequence++;
+	__dmb();
+	shadow = *newShadow;
+	__dmb();
+	shadowSequence++;
+}
+
+static void DS1307_Clock_SqwCallback(uint gpio, uint32_t events)
+{
+	if((gpio != clockSqwGpio) || !(events & GPIO_IRQ_EDGE_FALL))
+	{
+		return;
+	}
+
+	DS1307_ClockShadow_t newShadow = shadow;
+	newShadow.edgeTimeUs = time_us_64();
+	newShadow.secondsSince2000++;
+	DS1307_AddSecond(&newShadow.dateTime);
+	DS1307_Clock_Publish(&newShadow);
+
+	tickCount++;
+	if((tickCount - lastResyncTick) >= clockResyncInterval)
+	{
+		resyncPending = true;
+	}
+
+	if(tickHook != NULL)
+	{
+		tickHook(newShadow.secondsSince2000);
+	}
+}
+
+/* Read the RTC and store it in the shadow - if an edge arrived while reading, the result may be stale, so try again */
+static uint8_t DS1307_Clock_Resync()
+{
+	const uint32_t maxAttempts = 3;
+	DS1307_ClockShadow_t newShadow;
+
+	for(uint32_t attempt = 0; attempt < maxAttempts; attempt++)
+	{
+		uint32_t tickBefore = tickCount;
+
+		if(DS1307_ReadDateTime(&newShadow.dateTime) != STATUS_SUCCESS)
+		{
+			return MPU6050_REGISTER_I2C_READ_FAIL;
+		}
+		newShadow.secondsSince2000 = DS1307_ToSecondsSince2000(&newShadow.dateTime);
+		newShadow.edgeTimeUs = time_us_64(); /* Approximation used until the first edge is seen */
+
+		uint32_t interruptState = save_and_disable_interrupts();
+		if(tickCount == tickBefore)
+		{
+			if(tickCount > 0)
+			{
+				newShadow.edgeTimeUs = shadow.edgeTimeUs;
+			}
+			DS1307_Clock_Publish(&newShadow);
+			lastResyncTick = tickBefore;
+			resyncPending = false;
+			restore_interrupts(interruptState);
+			return STATUS_SUCCESS;
+		}
+		restore_interrupts(interruptState);
+	}
+
+	return STAUS_FAILURE;
+}
+
+/* I2C must be initialized before the clock is started */
+uint8_t DS1307_Clock_Start(uint32_t sqwGpio, uint32_t resyncIntervalSeconds)
+{
+	clockSqwGpio = sqwGpio;
+	clockResyncInterval = (resyncIntervalSeconds > 0) ? resyncIntervalSeconds : DS1307_CLOCK_DEFAULT_RESYNC_INTERVAL_S;
+	tickCount = 0;
+	lastResyncTick = 0;
+
+	if(Enable_DS1307_SquareWaveOutput(CONTROL_REG_RS_1HZ) != STATUS_SUCCESS)
+	{
+		return MPU6050_REGISTER_I2C_READ_FAIL;
+	}
+
+	gpio_init(sqwGpio);
+	gpio_set_dir(sqwGpio, GPIO_IN);
+	gpio_pull_up(sqwGpio);
+	gpio_set_irq_enabled_with_callback(sqwGpio, GPIO_IRQ_EDGE_FALL, true, DS1307_Clock_SqwCallback);
+	clockRunning = true;
+
+	/* Initial sync - done after the IRQ is enabled so that no edge can be missed */
+	return DS1307_Clock_Resync();
+}
+
+void DS1307_Clock_Stop()
+{
+	gpio_set_irq_enabled(clockSqwGpio, GPIO_IRQ_EDGE_FALL, false);
+	clockRunning = false;
+}
+
+/* Call periodically from thread context - does the (rare) I2C resync when it's due */
+uint8_t DS1307_Clock_Service()
+{
+	if(!clockRunning || !resyncPending)
+	{
+		return STATUS_SUCCESS;
+	}
+
+	return DS1307_Clock_Resync();
+}
+
+/* Lock-free read of the cached date/time - safe to call from any context */
+void DS1307_Clock_GetDateTime(DS1307_DateTime_t *dateTime)
+{
+	uint32_t sequence;
+
+	do
+	{
+		sequence = shadowSequence;
+		__dmb();
+		*dateTime = shadow.dateTime;
+		__dmb();
+	} while((sequence & 1) || (sequence != shadowSequence));
+}
+
+/* Microseconds since 2000-01-01 00:00:00 (RTC time) - lock-free, no I2C traffic */
+uint64_t DS1307_Clock_GetTimestampUs()
+{
+	const uint64_t maxSubSecondUs = 999999;
+	uint32_t sequence;
+	uint32_t seconds;
+	uint64_t edgeTimeUs;
+
+	do
+	{
+		sequence = shadowSequence;
+		__dmb();
+		seconds = shadow.secondsSince2000;
+		edgeTimeUs = shadow.edgeTimeUs;
+		__dmb();
+	} while((sequence & 1) || (sequence != shadowSequence));
+
+	uint64_t subSecondUs = time_us_64() - edgeTimeUs;
+	if(subSecondUs > maxSubSecondUs)
+	{
+		subSecondUs = maxSubSecondUs;
+	}
+
+	return ((uint64_t)seconds * 1000000u) + subSecondUs;
+}
+
+/** Software trim of the cached clock - set by the drift estimation (DS1307_Drift.c) instead of rewriting the RTC.
+ *  corrected = raw - offsetUs - (raw - anchorUs) * driftPpb / 10^9, raw = DS1307_Clock_GetTimestampUs().
+ *  The RTC registers (and everything reading raw RTC time, like the alarms) are not affected.
+ *  driftPpb is clamped to +-DS1307_CLOCK_MAX_TRIM_PPB.
+*/
+void DS1307_Clock_SetTrim(uint64_t anchorUs, int64_t offsetUs, int32_t driftPpb)
+{
+	if(driftPpb > DS1307_CLOCK_MAX_TRIM_PPB)
+	{
+		driftPpb = DS1307_CLOCK_MAX_TRIM_PPB;
+	}
+	else if(driftPpb < -DS1307_CLOCK_MAX_TRIM_PPB)
+	{
+		driftPpb = -DS1307_CLOCK_MAX_TRIM_PPB;
+	}
+
+	uint32_t interruptState = save_and_disable_interrupts();
+	trimAnchorUs = anchorUs;
+	trimOffsetUs = offsetUs;
+	trimDriftPpb = driftPpb;
+	restore_interrupts(interruptState);
+}
+
+/* DS1307_Clock_GetTimestampUs() with the drift trim applied - an estimate of the reference (e.g. network) time */
+uint64_t DS1307_Clock_GetCorrectedTimestampUs()
+{
+	uint64_t rawUs = DS1307_Clock_GetTimestampUs();
+
+	uint32_t interruptState = save_and_disable_interrupts();
+	uint64_t anchorUs = trimAnchorUs;
+	int64_t offsetUs = trimOffsetUs;
+	int32_t driftPpb = trimDriftPpb;
+	restore_interrupts(interruptState);
+
+	/* Whole seconds and the rest multiplied separately - sinceAnchorUs * driftPpb would overflow ~213 days after 
+	 * the anchor at 500ppm, (seconds * ppb) stays below 2^51 for the whole 2000-2099 range */
+	int64_t sinceAnchorUs = (int64_t)(rawUs - anchorUs);
+	int64_t sinceAnchorSeconds = sinceAnchorUs / 1000000;
+	int64_t restUs = sinceAnchorUs % 1000000;
+	int64_t driftUs = ((sinceAnchorSeconds * driftPpb) / 1000) + ((restUs * driftPpb) / 1000000000);
+	return rawUs - (uint64_t)(offsetUs + driftUs);
+}
+
+/* RTC seconds and RP2040 timer (time_us_64()) at the last SQW edge - the pair the drift estimation samples */
+void DS1307_Clock_GetLastEdge(uint32_t *secondsSince2000, uint64_t *edgeTimeUs)
+{
+	uint32_t sequence;
+
+	do
+	{
+		sequence = shadowSequence;
+		__dmb();
+		*secondsSince2000 = shadow.secondsSince2000;
+		*edgeTimeUs = shadow.edgeTimeUs;
+		__dmb();
+	} while((sequence & 1) || (sequence != shadowSequence));
+}
+
+/* Current RTC time in seconds since 2000-01-01 00:00:00 - lock-free, no I2C traffic */
+uint32_t DS1307_Clock_GetSeconds()
+{
+	uint32_t sequence;
+	uint32_t seconds;
+
+	do
+	{
+		sequence = shadowSequence;
+		__dmb();
+		seconds = shadow.secondsSince2000;
+		__dmb();
+	} while((sequence & 1) || (sequence != shadowSequence));
+
+	return seconds;
+}
+
+/* 'hook' is called from the SQW interrupt after every new second (NULL - no hook) */
+void DS1307_Clock_SetTickHook(DS1307_ClockTickHook_t hook)
+{
+	tickHook = hook;
+}
+
+/* Number of SQW edges seen since DS1307_Clock_Start() */
+uint32_t DS1307_Clock_GetTickCount()
+{
+	return tickCount;
+}
@@ -0,0 +1,181 @@
+/**
+ * Drift estimation of the DS1307 crystal (typ. +-20ppm, worse over temperature) against a reference clock.
+ * 
+ * - Every sample is a pair (RTC time, reference time). The offset error = RTC - reference is fitted linearly 
+ *   over the reference time with least squares: the slope is the drift - with the reference in seconds and 
+ *   the error in microseconds, the slope is directly in ppm (computed in ppb, integer only - no FPU on the M0+).
+ * - The fit uses the last DS1307_DRIFT_WINDOW samples, recomputed on every new sample around their means (small 
+ *   numbers - no overflow of the 64-bit sums), so it follows the drift as the temperature changes.
+ * - No estimate until the samples span enough reference time (DS1307_DRIFT_MIN_SUM_XX) - closely spaced samples 
+ *   make the slope mostly jitter. Estimates are clamped to +-DS1307_CLOCK_MAX_TRIM_PPB.
+ * - With auto trim (default) every new estimate goes to DS1307_Clock_SetTrim(): 
+ *   DS1307_Clock_GetCorrectedTimestampUs() then reads the reference time, estimated from the cached clock.
+ *   The RTC registers are never rewritten, the network time syncs can be much rarer.
+ * 
+ * Reference sources - one per fit (the time bases differ), switching sources starts a new fit:
+ * - DS1307_Drift_AddReference(): an external sync (network/GPS time), compared with the cached clock - 
+ *   the trim corrects both the offset and the rate.
+ * - DS1307_Drift_SampleLocalTimer(): the RP2040 timer latched at the last SQW edge - only as good as the 
+ *   RP2040 crystal (typ. +-30ppm), but free. Sample e.g. once per minute. Corrects the rate only.
+ * Call from thread context.
+*/
+
+#include "pico/stdlib.h"
+#include "DS1307_Drift.h"
+#include "DS1307_Clock.h"
+#include "I2C_Driver.h"
+
+typedef struct
+{
+	uint64_t referenceUs;
+	int64_t errorUs;		/* RTC - reference */
+} DS1307_DriftSample_t;
+
+static DS1307_DriftSample_t samples[DS1307_DRIFT_WINDOW];
+static uint32_t sampleCount = 0;
+static uint32_t sampleNext = 0;
+static bool estimateValid = false;
+static int32_t estimatePpb = 0;
+static bool autoTrim = true;
+static bool referenceIsRtcTimeBase = true; /* false - RP2040 timer: only the rate can be corrected, not the offset */
+
+void DS1307_Drift_Reset()
+{
+	sampleCount = 0;
+	sampleNext = 0;
+	estimateValid = false;
+	estimatePpb = 0;
+	if(autoTrim)
+	{
+		DS1307_Clock_SetTrim(0, 0, 0);
+	}
+}
+
+/* Least-squares fit of the window: error = meanError + drift * (reference - meanReference) */
+static void DS1307_Drift_Fit()
+{
+	int64_t meanErrorUs = 0;
+	uint64_t baseUs = samples[(sampleNext + DS1307_DRIFT_WINDOW - sampleCount) % DS1307_DRIFT_WINDOW].referenceUs;
+	int64_t meanOffsetUs = 0;	/* Mean of reference - baseUs */
+	int64_t sumXY = 0;
+	int64_t sumXX = 0;
+
+	for(uint32_t i = 0; i < sampleCount; i++)
+	{
+		meanOffsetUs += (int64_t)(samples[i].referenceUs - baseUs);
+		meanErrorUs += samples[i].errorUs;
+	}
+	meanOffsetUs /= (int64_t)sampleCount;
+	meanErrorUs /= (int64_t)sampleCount;
+
+	for(uint32_t i = 0; i < sampleCount; i++)
+	{
+		int64_t dxUs = (int64_t)(samples[i].referenceUs - baseUs) - meanOffsetUs;
+		/* Seconds, rounded - whole seconds keep the sums far from overflow even for a window spanning months */
+		int64_t dxSeconds = (dxUs >= 0) ? ((dxUs + 500000) / 1000000) : -((500000 - dxUs) / 1000000);
+		int64_t dyUs = samples[i].errorUs - meanErrorUs;
+		sumXY += dxSeconds * dyUs;
+		sumXX += dxSeconds * dxSeconds;
+	}
+
+	if(sumXX < DS1307_DRIFT_MIN_SUM_XX)
+	{
+		return; /* Samples too close together - keep the previous estimate */
+	}
+
+	/* x in s, y in us: the slope is in us/s = ppm. ppb = 1000 * sumXY / sumXX, split so 1000 * sumXY can't overflow. 
+	 * Clamped before the int32_t cast (a bad reference time can give any slope) */
+	int64_t quotient = sumXY / sumXX;
+	int64_t remainder = sumXY % sumXX;
+	int64_t ppb = (quotient * 1000) + ((remainder * 1000) / sumXX);
+	if((quotient > (DS1307_CLOCK_MAX_TRIM_PPB / 1000)) || (ppb > DS1307_CLOCK_MAX_TRIM_PPB))
+	{
+		ppb = DS1307_CLOCK_MAX_TRIM_PPB;
+	}
+	else if((quotient < -(DS1307_CLOCK_MAX_TRIM_PPB / 1000)) || (ppb < -DS1307_CLOCK_MAX_TRIM_PPB))
+	{
+		ppb = -DS1307_CLOCK_MAX_TRIM_PPB;
+	}
+	estimatePpb = (int32_t)ppb;
+	estimateValid = true;
+
+	if(autoTrim)
+	{
+		/* Anchor on the RTC time base - the RTC time at the mean reference time */
+		uint64_t anchorUs = baseUs + (uint64_t)meanOffsetUs + (uint64_t)meanErrorUs;
+		DS1307_Clock_SetTrim(anchorUs, referenceIsRtcTimeBase ? meanErrorUs : 0, estimatePpb);
+	}
+}
+
+static uint8_t DS1307_Drift_Add(uint64_t rtcUs, uint64_t referenceUs, bool rtcTimeBase)
+{
+	if((sampleCount > 0) && (rtcTimeBase != referenceIsRtcTimeBase))
+	{
+		DS1307_Drift_Reset(); /* Another reference source - the old samples don't fit */
+	}
+	referenceIsRtcTimeBase = rtcTimeBase;
+
+	samples[sampleNext].referenceUs = referenceUs;
+	samples[sampleNext].errorUs = (int64_t)(rtcUs - referenceUs);
+	sampleNext = (sampleNext + 1) % DS1307_DRIFT_WINDOW;
+	if(sampleCount < DS1307_DRIFT_WINDOW)
+	{
+		sampleCount++;
+	}
+
+	if(sampleCount >= DS1307_DRIFT_MIN_SAMPLES)
+	{
+		DS1307_Drift_Fit();
+	}
+
+	return STATUS_SUCCESS;
+}
+
+/* Add one (RTC, reference) pair - both in microseconds since 2000-01-01 00:00:00 (same time zone) */
+uint8_t DS1307_Drift_AddSample(uint64_t rtcUs, uint64_t referenceUs)
+{
+	return DS1307_Drift_Add(rtcUs, referenceUs, true);
+}
+
+/* An external time (microseconds since 2000-01-01 00:00:00, same time zone as the RTC) arrived just now */
+uint8_t DS1307_Drift_AddReference(uint64_t referenceUsSince2000)
+{
+	return DS1307_Drift_AddSample(DS1307_Clock_GetTimestampUs(), referenceUsSince2000);
+}
+
+/* Sample the RP2040 timer against the last SQW edge of the cached clock (DS1307_Clock_Start() must be running) */
+uint8_t DS1307_Drift_SampleLocalTimer()
+{
+	uint32_t secondsSince2000;
+	uint64_t edgeTimeUs;
+
+	if(DS1307_Clock_GetTickCount() == 0)
+	{
+		return STATUS_BUSY; /* No edge seen yet - the edge time is only approximate */
+	}
+
+	DS1307_Clock_GetLastEdge(&secondsSince2000, &edgeTimeUs);
+	return DS1307_Drift_Add((uint64_t)secondsSince2000 * 1000000u, edgeTimeUs, false);
+}
+
+/* Drift in ppb (positive - the RTC runs fast). Fails until the samples span DS1307_DRIFT_MIN_SUM_XX */
+uint8_t DS1307_Drift_GetPpb(int32_t *driftPpb)
+{
+	if(!estimateValid)
+	{
+		return STAUS_FAILURE;
+	}
+	*driftPpb = estimatePpb;
+	return STATUS_SUCCESS;
+}
+
+uint32_t DS1307_Drift_SampleCount()
+{
+	return sampleCount;
+}
+
+/* false - only estimate (DS1307_Drift_GetPpb()), the cached clock isn't trimmed */
+void DS1307_Drift_SetAutoTrim(bool enabled)
+{
+	autoTrim = enabled;
+}
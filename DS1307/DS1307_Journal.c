@@ -0,0 +1,137 @@
+/**
+ * Power-fail safe checkpoint store in the DS1307 NVRAM (08h-3Fh).
+ * 
+ * How it works:
+ * - The 56 bytes are split into two slots. Every slot holds a sequence number, the payload and a CRC16 over both.
+ * - A commit always writes the slot that does NOT hold the latest record, with the sequence number incremented, 
+ *   in one burst write. If power fails in the middle of it the CRC of that slot is wrong and the previous record 
+ *   in the other slot is still intact - a commit is atomic.
+ * - Recovery is a single 56 byte burst read: both slots are checked and the valid one with the newer sequence 
+ *   number (compared with wrap-around) wins.
+*/
+
+#include <string.h>
+#include "DS1307_HAL.h"
+#include "DS1307.h"
+#include "DS1307_Journal.h"
+#include "I2C_Driver.h"
+
+static bool journalRecovered = false;
+static uint8_t latestSlot = DS1307_JOURNAL_SLOT_COUNT - 1; /* So that the first commit goes to slot 0 */
+static uint8_t latestSequence = 0;
+
+uint16_t DS1307_Journal_Crc16(const uint8_t *data, size_t length)
+{
+	uint16_t crc = DS1307_JOURNAL_CRC16_INIT;
+
+	for(size_t i = 0; i < length; i++)
+	{
+		crc ^= (uint16_t)data[i] << 8;
+		for(uint8_t bit = 0; bit < 8; bit++)
+		{
+			crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ DS1307_JOURNAL_CRC16_POLY) : (uint16_t)(crc << 1);
+		}
+	}
+
+	return crc;
+}
+
+static bool DS1307_Journal_SlotValid(const uint8_t *slot)
+{
+	const size_t crcOffset = DS1307_JOURNAL_HEADER_SIZE + DS1307_JOURNAL_PAYLOAD_SIZE;
+	uint16_t storedCrc = ((uint16_t)slot[crcOffset] << 8) | slot[crcOffset + 1];
+
+	return (DS1307_Journal_Crc16(slot, crcOffset) == storedCrc);
+}
+
+/* Find the latest valid record and copy its payload (DS1307_JOURNAL_PAYLOAD_SIZE bytes) - one NVRAM burst read */
+uint8_t DS1307_Journal_Recover(uint8_t *payload)
+{
+	uint8_t nvram_au8[DS1307_NVRAM_SIZE];
+	int latestValid = -1;
+
+	if(DS1307_NVRAM_Read(0, nvram_au8, sizeof(nvram_au8)) != STATUS_SUCCESS)
+	{
+		return MPU6050_REGISTER_I2C_READ_FAIL;
+	}
+
+	for(uint8_t slotIndex = 0; slotIndex < DS1307_JOURNAL_SLOT_COUNT; slotIndex++)
+	{
+		const uint8_t *slot = &nvram_au8[slotIndex * DS1307_JOURNAL_SLOT_SIZE];
+
+		if(!DS1307_Journal_SlotValid(slot))
+		{
+			continue;
+		}
+		/* Sequence numbers wrap around - the newer one is "ahead" by less than half the range */
+		if((latestValid < 0) || ((int8_t)(slot[0] - latestSequence) > 0))
+		{
+			latestValid = slotIndex;
+			latestSequence = slot[0];
+		}
+	}
+
+	journalRecovered = true;
+
+	if(latestValid < 0)
+	{
+		latestSlot = DS1307_JOURNAL_SLOT_COUNT - 1;
+		latestSequence = 0;
+		return DS1307_JOURNAL_NO_RECORD;
+	}
+
+	latestSlot = (uint8_t)latestValid;
+	if(payload != NULL)
+	{
+		memcpy(payload, &nvram_au8[(latestSlot * DS1307_JOURNAL_SLOT_SIZE) + DS1307_JOURNAL_HEADER_SIZE], DS1307_JOURNAL_PAYLOAD_SIZE);
+	}
+
+	return STATUS_SUCCESS;
+}
+
+/** Store a new checkpoint (up to DS1307_JOURNAL_PAYLOAD_SIZE bytes, the rest is zero-filled) - one burst write of one slot.
+ *  'payload' may only be NULL with 'length' = 0 (an all-zero record).
+*/
+uint8_t DS1307_Journal_Commit(const uint8_t *payload, size_t length)
+{
+	uint8_t slot[DS1307_JOURNAL_SLOT_SIZE];
+	const size_t crcOffset = DS1307_JOURNAL_HEADER_SIZE + DS1307_JOURNAL_PAYLOAD_SIZE;
+
+	if((length > DS1307_JOURNAL_PAYLOAD_SIZE) || ((payload == NULL) && (length > 0)))
+	{
+		return STAUS_FAILURE;
+	}
+
+	/* Need to know which slot is the older one - costs one read, only before the first commit */
+	if(!journalRecovered)
+	{
+		uint8_t recoverStatus = DS1307_Journal_Recover(NULL);
+		if((recoverStatus != STATUS_SUCCESS) && (recoverStatus != DS1307_JOURNAL_NO_RECORD))
+		{
+			return recoverStatus;
+		}
+	}
+
+	uint8_t targetSlot = (uint8_t)((latestSlot + 1) % DS1307_JOURNAL_SLOT_COUNT);
+	uint8_t sequence = (uint8_t)(latestSequence + 1);
+
+	slot[0] = sequence;
+	if(length > 0)
+	{
+		memcpy(&slot[DS1307_JOURNAL_HEADER_SIZE], payload, length);
+	}
+	memset(&slot[DS1307_JOURNAL_HEADER_SIZE + length], 0, DS1307_JOURNAL_PAYLOAD_SIZE - length);
+	uint16_t crc = DS1307_Journal_Crc16(slot, crcOffset);
+	slot[crcOffset] = (uint8_t)(crc >> 8);
+	slot[crcOffset + 1] = (uint8_t)crc;
+
+	if(DS1307_NVRAM_Write(targetSlot * DS1307_JOURNAL_SLOT_SIZE, slot, sizeof(slot)) != STATUS_SUCCESS)
+	{
+		return MPU6050_REGISTER_I2C_READ_FAIL;
+	}
+
+	latestSlot = targetSlot;
+	latestSequence = sequence;
+
+	return STATUS_SUCCESS;
+}
@@ -0,0 +1,93 @@
+/**
+ * Deferred ring-buffer logger (DS1307_LOG_DEFERRED = 1) - see DS1307_Log.h.
+ * Producers on either core or in interrupts only copy a few words under a hardware spin lock,
+ * DS1307_Log_Drain() prints the entries outside of the lock.
+*/
+
+#include "DS1307_Log.h"
+
+#if(DS1307_LOG_DEFERRED == 1)
+
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+
+typedef struct
+{
+	const char *format;
+	uint32_t args[DS1307_LOG_MAX_ARGS];
+} DS1307_LogEntry_t;
+
+static DS1307_LogEntry_t logBuffer[DS1307_LOG_BUFFER_ENTRIES];
+static uint32_t logHead = 0;
+static uint32_t logTail = 0;
+static uint32_t logDropped = 0;
+static spin_lock_t *logLock = NULL;
+
+static spin_lock_t *DS1307_Log_GetLock()
+{
+	if(logLock == NULL)
+	{
+		/* Claimed on first use - made safe by claiming before any other core logs (e.g. in the first log from init) */
+		logLock = spin_lock_init((uint)spin_lock_claim_unused(true));
+	}
+	return logLock;
+}
+
+void DS1307_Log_Push(const char *format, const uint32_t *args, size_t argCount)
+{
+	spin_lock_t *lock = DS1307_Log_GetLock();
+	uint32_t interruptState = spin_lock_blocking(lock);
+
+	if((logHead - logTail) >= DS1307_LOG_BUFFER_ENTRIES)
+	{
+		logDropped++;
+	}
+	else
+	{
+		DS1307_LogEntry_t *entry = &logBuffer[logHead % DS1307_LOG_BUFFER_ENTRIES];
+		entry->format = format;
+		for(size_t i = 0; i < DS1307_LOG_MAX_ARGS; i++)
+		{
+			entry->args[i] = (i < argCount) ? args[i] : 0;
+		}
+		logHead++;
+	}
+
+	spin_unlock(lock, interruptState);
+}
+
+/* Print everything that is queued - returns the number of printed entries */
+uint32_t DS1307_Log_Drain()
+{
+	spin_lock_t *lock = DS1307_Log_GetLock();
+	uint32_t printed = 0;
+
+	while(true)
+	{
+		DS1307_LogEntry_t entry;
+		uint32_t interruptState = spin_lock_blocking(lock);
+
+		if(logTail == logHead)
+		{
+			spin_unlock(lock, interruptState);
+			break;
+		}
+		entry = logBuffer[logTail % DS1307_LOG_BUFFER_ENTRIES];
+		logTail++;
+		spin_unlock(lock, interruptState);
+
+		printf(entry.format, entry.args[0], entry.args[1], entry.args[2], entry.args[3], entry.args[4], entry.args[5]);
+		printed++;
+	}
+
+	return printed;
+}
+
+/* Entries lost because the ring buffer was full */
+uint32_t DS1307_Log_DroppedCount()
+{
+	return logDropped;
+}
+
+#endif /* DS1307_LOG_DEFERRED */
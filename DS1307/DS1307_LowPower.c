@@ -0,0 +1,128 @@
+/**
+ * Duty-cycled mode for battery nodes that wake once per second to read the time.
+ * 
+ * - The DS1307 drives a 1Hz square wave on SQW/OUT (control register 07h, SQWE = 1, RS = 00). Its falling edge 
+ *   is when the seconds counter increments (same edge as DS1307_Clock.c), so a read right after it always sees 
+ *   a fresh second.
+ * - Between edges the core sleeps in WFE and the I2C controller is held in reset (I2C_Bus_Suspend()).
+ *   The GPIO interrupt of the SQW pin is enabled in IO_BANK0 but not in the NVIC: with SCR.SEVONPEND set, the 
+ *   pending interrupt wakes WFE without any handler running - nothing else has to be reconfigured, and other 
+ *   interrupts (timers, USB) work as usual (they wake the core too, it goes back to sleep until the edge).
+ * - On the edge the controller is released and the timekeeper block is read with a single 7 byte burst - the 
+ *   whole wake costs one transaction (~10 bytes on the bus - under 1ms at 100kHz, ~250us at 400kHz).
+ * 
+ * Requires IO_IRQ_BANK0 to stay disabled in the NVIC while running, so it doesn't combine with DS1307_Clock.c or 
+ * other GPIO interrupt users. The deeper DORMANT state (crystal oscillator stopped) needs pico-extras' 
+ * pico_sleep and all clocks reinitialized on wake - not used here, WFE keeps the wake to a few cycles.
+*/
+
+#include "pico/stdlib.h"
+#include "hardware/gpio.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#include "hardware/structs/iobank0.h"
+#include "hardware/structs/scb.h"
+#include "hardware/regs/m0plus.h"
+#include "DS1307.h"
+#include "DS1307_LowPower.h"
+#include "I2C_Driver.h"
+
+#define GPIO_IRQ_EVENTS_PER_REG		8 /* IO_BANK0 INTRx: 4 event bits for each of 8 GPIOs */
+#define GPIO_IRQ_EVENT_BITS			4
+
+static I2C_Device_t *lowPowerRtc = NULL;
+static uint32_t lowPowerGpio;
+
+static bool DS1307_LowPower_EdgePending()
+{
+	uint32_t eventShift = GPIO_IRQ_EVENT_BITS * (lowPowerGpio % GPIO_IRQ_EVENTS_PER_REG);
+	return (io_bank0_hw->intr[lowPowerGpio / GPIO_IRQ_EVENTS_PER_REG] >> eventShift) & GPIO_IRQ_EDGE_FALL;
+}
+
+/** Switch SQW/OUT to 1Hz, arm the SQW GPIO as wake source and suspend the bus.
+ *  Returns STATUS_BUSY if IO_IRQ_BANK0 is enabled (another GPIO interrupt user) - the wake-up scheme needs it off.
+*/
+uint8_t DS1307_LowPower_Start(I2C_Device_t *rtc, uint32_t sqwGpio)
+{
+	if(irq_is_enabled(IO_IRQ_BANK0))
+	{
+		return STATUS_BUSY;
+	}
+	if(DS1307_Dev_EnableSquareWaveOutput(rtc, CONTROL_REG_RS_1HZ) != STATUS_SUCCESS)
+	{
+		return MPU6050_REGISTER_I2C_READ_FAIL;
+	}
+
+	lowPowerRtc = rtc;
+	lowPowerGpio = sqwGpio;
+
+	/* SQW/OUT is open drain */
+	gpio_init(sqwGpio);
+	gpio_set_dir(sqwGpio, GPIO_IN);
+	gpio_pull_up(sqwGpio);
+
+	gpio_acknowledge_irq(sqwGpio, GPIO_IRQ_EDGE_FALL);
+	gpio_set_irq_enabled(sqwGpio, GPIO_IRQ_EDGE_FALL, true);
+	irq_clear(IO_IRQ_BANK0);
+	hw_set_bits(&scb_hw->scr, M0PLUS_SCR_SEVONPEND_BITS);
+
+	I2C_Bus_Suspend(rtc->bus);
+
+	return STATUS_SUCCESS;
+}
+
+/** Sleep until the next SQW falling edge (the next second), then read the raw timekeeper block (00h-06h) with 
+ *  the bus released only for that one transfer.
+*/
+uint8_t DS1307_LowPower_WaitForTickRaw(uint8_t *timekeeperRegs)
+{
+	uint8_t status;
+
+	if(lowPowerRtc == NULL)
+	{
+		return STAUS_FAILURE;
+	}
+
+	/* An edge that came while awake counts as well - no second is skipped if the caller was slow */
+	while(!DS1307_LowPower_EdgePending())
+	{
+		__wfe();
+	}
+	gpio_acknowledge_irq(lowPowerGpio, GPIO_IRQ_EDGE_FALL);
+	irq_clear(IO_IRQ_BANK0);
+
+	I2C_Bus_Resume(lowPowerRtc->bus);
+	status = I2C_Dev_Burst_Read(lowPowerRtc, DS1307_REG_SECONDS, timekeeperRegs, DS1307_TIMEKEEPER_REGS_LENGTH);
+	I2C_Bus_Suspend(lowPowerRtc->bus);
+
+	return (status == STATUS_SUCCESS) ? STATUS_SUCCESS : MPU6050_REGISTER_I2C_READ_FAIL;
+}
+
+uint8_t DS1307_LowPower_WaitForTick(DS1307_DateTime_t *dateTime)
+{
+	uint8_t timekeeperRegs_au8[DS1307_TIMEKEEPER_REGS_LENGTH];
+	uint8_t status = DS1307_LowPower_WaitForTickRaw(timekeeperRegs_au8);
+
+	if(status == STATUS_SUCCESS)
+	{
+		DS1307_DecodeDateTime(timekeeperRegs_au8, dateTime);
+	}
+	return status;
+}
+
+/* Disarm the wake source and release the bus - SQW/OUT keeps running at 1Hz */
+void DS1307_LowPower_Stop()
+{
+	if(lowPowerRtc == NULL)
+	{
+		return;
+	}
+
+	gpio_set_irq_enabled(lowPowerGpio, GPIO_IRQ_EDGE_FALL, false);
+	gpio_acknowledge_irq(lowPowerGpio, GPIO_IRQ_EDGE_FALL);
+	irq_clear(IO_IRQ_BANK0);
+	hw_clear_bits(&scb_hw->scr, M0PLUS_SCR_SEVONPEND_BITS);
+
+	I2C_Bus_Resume(lowPowerRtc->bus);
+	lowPowerRtc = NULL;
+}
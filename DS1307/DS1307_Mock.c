@@ -0,0 +1,126 @@
+/**
+ * Software model of the DS1307 behind the I2C_BackendTransfer_t seam (see I2C_Bus_SetBackend()) - the whole driver above 
+ * the transaction layer (date/time, NVRAM, journal, cache...) runs unchanged against it, without an RTC on the bus.
+ * 
+ * Emulated (DS1307 Datasheet):
+ * - 64 byte register file: timekeeper 00h-06h, control 07h, NVRAM 08h-3Fh.
+ * - Register pointer set by the first written byte and auto-incremented by every byte read/written, wrapping from 
+ *   3Fh to 00h. A read without a preceding write continues at the current pointer.
+ * - Power-up state: 01/01/00 01 00:00:00 with the CH bit set (oscillator halted), control register RS1/RS0 = 1.
+ * - CH bit: DS1307_Mock_Tick() only advances the time while CH is 0. 
+ * - Only the implemented bits of the control register (OUT, SQWE, RS1, RS0) can be set.
+ * Not emulated: 12-hour mode in DS1307_Mock_Tick() (the time is advanced as 24h), the SQW/OUT pin.
+ * 
+ * transactionCount/bytesOnBus count what the real bus would carry, to measure the I2C cost of driver operations.
+*/
+
+#include <string.h>
+#include "DS1307.h"
+#include "DS1307_Mock.h"
+#include "I2C_Driver.h"
+
+#define DS1307_MOCK_POINTER_MASK (DS1307_MOCK_REGISTER_COUNT - 1)
+
+void DS1307_Mock_Init(DS1307_Mock_t *mock)
+{
+	memset(mock, 0, sizeof(*mock));
+	mock->address = DS1307_I2C_ADDRESS;
+
+	mock->regs[0] = CH_BIT_REG_0_READ_MASK;	/* 00 seconds, oscillator halted */
+	mock->regs[2] = 0x00;					/* 00:00:00 */
+	mock->regs[3] = 0x01;
+	mock->regs[4] = 0x01;
+	mock->regs[5] = 0x01;
+	mock->regs[DS1307_REG_CONTROL] = CONTROL_REG_RS_32768HZ;
+}
+
+static void DS1307_Mock_WriteRegister(DS1307_Mock_t *mock, uint8_t value)
+{
+	if(mock->pointer == DS1307_REG_CONTROL)
+	{
+		value &= DS1307_MOCK_CONTROL_WRITE_MASK;
+	}
+	mock->regs[mock->pointer] = value;
+	mock->pointer = (mock->pointer + 1) & DS1307_MOCK_POINTER_MASK;
+}
+
+/* I2C_BackendTransfer_t - 'context' is the DS1307_Mock_t */
+uint8_t DS1307_Mock_Transfer(void *context, uint8_t address, const uint8_t *txData, size_t txLength, uint8_t *rxData, size_t rxLength)
+{
+	DS1307_Mock_t *mock = (DS1307_Mock_t *)context;
+
+	mock->transactionCount++;
+	mock->bytesOnBus += 1; /* Address byte */
+
+	if((address != mock->address) || (mock->failNextCount > 0))
+	{
+		if(mock->failNextCount > 0)
+		{
+			mock->failNextCount--;
+		}
+		return I2C_ERROR_ADDRESS_NACK;
+	}
+
+	if(txLength > 0)
+	{
+		mock->pointer = txData[0] & DS1307_MOCK_POINTER_MASK;
+		for(size_t i = 1; i < txLength; i++)
+		{
+			DS1307_Mock_WriteRegister(mock, txData[i]);
+		}
+		mock->bytesOnBus += txLength;
+	}
+
+	if(rxLength > 0)
+	{
+		if(txLength > 0)
+		{
+			mock->bytesOnBus += 1; /* Address byte after the repeated START */
+		}
+		for(size_t i = 0; i < rxLength; i++)
+		{
+			rxData[i] = mock->regs[mock->pointer];
+			mock->pointer = (mock->pointer + 1) & DS1307_MOCK_POINTER_MASK;
+		}
+		mock->bytesOnBus += rxLength;
+	}
+
+	return I2C_ERROR_NONE;
+}
+
+/* Route the blocking transfers of 'bus' to the mock (the bus doesn't have to be initialized) */
+void DS1307_Mock_Attach(DS1307_Mock_t *mock, I2C_Bus_t *bus)
+{
+	I2C_Bus_SetBackend(bus, DS1307_Mock_Transfer, mock);
+}
+
+/* Let 'seconds' of time pass - the timekeeper registers count like the oscillator would, unless CH is set */
+void DS1307_Mock_Tick(DS1307_Mock_t *mock, uint32_t seconds)
+{
+	DS1307_DateTime_t dateTime;
+
+	if(mock->regs[0] & CH_BIT_REG_0_READ_MASK)
+	{
+		return;
+	}
+
+	DS1307_DecodeDateTime(mock->regs, &dateTime);
+	while(seconds-- > 0)
+	{
+		DS1307_AddSecond(&dateTime);
+	}
+
+	mock->regs[0] = DS1307_DecToBcd(dateTime.seconds);
+	mock->regs[1] = DS1307_DecToBcd(dateTime.minutes);
+	mock->regs[2] = DS1307_DecToBcd(dateTime.hours);
+	mock->regs[3] = DS1307_DecToBcd(dateTime.dayOfWeek);
+	mock->regs[4] = DS1307_DecToBcd(dateTime.date);
+	mock->regs[5] = DS1307_DecToBcd(dateTime.month);
+	mock->regs[6] = DS1307_DecToBcd(dateTime.year);
+}
+
+void DS1307_Mock_ResetStats(DS1307_Mock_t *mock)
+{
+	mock->transactionCount = 0;
+	mock->bytesOnBus = 0;
+}
@@ -0,0 +1,225 @@
+/**
+ * Write-back cache of the DS1307 NVRAM (08h-3Fh).
+ * 
+ * How it works:
+ * - DS1307_NVRAMCache_Load() fills a RAM mirror of the 56 bytes with one burst read.
+ * - Reads and writes only touch the mirror. Every byte that actually changes is marked in a 56-bit dirty bitmap.
+ * - A flush turns the dirty bitmap into as few burst writes as possible: contiguous dirty bytes form one run and 
+ *   runs separated by small clean gaps are merged into one transaction (see DS1307_NVRAM_CACHE_MERGE_GAP).
+ * - Flushing can be done explicitly, periodically (a repeating timer requests it, DS1307_NVRAMCache_Service() 
+ *   does it in thread context) or from the application's power-fail GPIO interrupt (DS1307_NVRAMCache_PowerFailFlush).
+ * - Only one flush runs at a time (flushInProgress). A power-fail interrupt that arrives during a thread-level flush 
+ *   doesn't start a second transfer on the controller in the middle of the running one - it leaves the work to that 
+ *   flush, which then keeps going until the whole mirror is clean.
+*/
+
+#include <string.h>
+#include "DS1307_HAL.h"
+#include "DS1307.h"
+#include "DS1307_NVRAMCache.h"
+#include "I2C_Driver.h"
+
+static uint8_t nvramMirror[DS1307_NVRAM_SIZE];
+static volatile uint64_t dirtyBitmap = 0; /* Bit n set - byte n of the mirror differs from the DS1307 */
+static volatile bool flushRequested = false;
+static volatile bool flushInProgress = false;
+static volatile bool powerFailPending = false; /* Power fail seen during a flush - that flush writes everything */
+static bool cacheLoaded = false;
+static repeating_timer_t flushTimer;
+static bool flushTimerRunning = false;
+
+uint8_t DS1307_NVRAMCache_Load()
+{
+	if(DS1307_NVRAM_Read(0, nvramMirror, sizeof(nvramMirror)) != STATUS_SUCCESS)
+	{
+		return MPU6050_REGISTER_I2C_READ_FAIL;
+	}
+
+	dirtyBitmap = 0;
+	cacheLoaded = true;
+
+	return STATUS_SUCCESS;
+}
+
+uint8_t DS1307_NVRAMCache_Read(uint8_t offset, uint8_t *buffer, size_t length)
+{
+	if(!cacheLoaded || (((size_t)offset + length) > DS1307_NVRAM_SIZE))
+	{
+		return STAUS_FAILURE;
+	}
+
+	memcpy(buffer, &nvramMirror[offset], length);
+
+	return STATUS_SUCCESS;
+}
+
+uint8_t DS1307_NVRAMCache_Write(uint8_t offset, const uint8_t *data, size_t length)
+{
+	if(!cacheLoaded || (((size_t)offset + length) > DS1307_NVRAM_SIZE))
+	{
+		return STAUS_FAILURE;
+	}
+
+	/* A flush may run from an interrupt (power fail) - keep mirror and bitmap consistent */
+	uint32_t interruptState = save_and_disable_interrupts();
+	for(size_t i = 0; i < length; i++)
+	{
+		if(nvramMirror[offset + i] != data[i])
+		{
+			nvramMirror[offset + i] = data[i];
+			dirtyBitmap |= (1ULL << (offset + i));
+		}
+	}
+	restore_interrupts(interruptState);
+
+	return STATUS_SUCCESS;
+}
+
+/** Write all dirty runs - interrupts are only disabled while taking a snapshot of a run, not during the I2C transfer.
+ *  Returns STATUS_BUSY if another flush is already running (e.g. the one this interrupt preempted).
+*/
+uint8_t DS1307_NVRAMCache_Flush()
+{
+	uint8_t runData[DS1307_NVRAM_SIZE];
+	uint8_t status = STATUS_SUCCESS;
+	size_t index = 0;
+
+	uint32_t interruptState = save_and_disable_interrupts();
+	if(flushInProgress)
+	{
+		restore_interrupts(interruptState);
+		return STATUS_BUSY;
+	}
+	flushInProgress = true;
+	flushRequested = false;
+	restore_interrupts(interruptState);
+
+	for(;;)
+	{
+		while(index < DS1307_NVRAM_SIZE)
+		{
+			/* Find the next run: starts at a dirty byte, ends at a clean gap longer than the merge limit */
+			if(!(dirtyBitmap & (1ULL << index)))
+			{
+				index++;
+				continue;
+			}
+
+			size_t runStart = index;
+			size_t runEnd = index; /* Last dirty byte of the run */
+			for(size_t next = index + 1; (next < DS1307_NVRAM_SIZE) && (next <= (runEnd + DS1307_NVRAM_CACHE_MERGE_GAP + 1)); next++)
+			{
+				if(dirtyBitmap & (1ULL << next))
+				{
+					runEnd = next;
+				}
+			}
+			size_t runLength = runEnd - runStart + 1;
+			uint64_t runMask = ((runLength >= 64) ? ~0ULL : ((1ULL << runLength) - 1)) << runStart;
+
+			interruptState = save_and_disable_interrupts();
+			memcpy(runData, &nvramMirror[runStart], runLength);
+			dirtyBitmap &= ~runMask;
+			restore_interrupts(interruptState);
+
+			if(DS1307_NVRAM_Write((uint8_t)runStart, runData, runLength) != STATUS_SUCCESS)
+			{
+				/* Keep the bytes dirty so the next flush retries them */
+				interruptState = save_and_disable_interrupts();
+				dirtyBitmap |= runMask;
+				restore_interrupts(interruptState);
+				status = MPU6050_REGISTER_I2C_READ_FAIL;
+			}
+
+			index = runEnd + 1;
+		}
+
+		/* A power fail during this flush - also write what was dirtied behind 'index' meanwhile (until a write fails) */
+		interruptState = save_and_disable_interrupts();
+		bool again = powerFailPending && (dirtyBitmap != 0) && (status == STATUS_SUCCESS);
+		if(!again)
+		{
+			powerFailPending = false;
+			flushInProgress = false;
+		}
+		restore_interrupts(interruptState);
+
+		if(!again)
+		{
+			break;
+		}
+		index = 0;
+	}
+
+	return status;
+}
+
+bool DS1307_NVRAMCache_IsDirty()
+{
+	return (dirtyBitmap != 0);
+}
+
+static bool DS1307_NVRAMCache_TimerCallback(repeating_timer_t *timer)
+{
+	(void)timer;
+	if(dirtyBitmap != 0)
+	{
+		flushRequested = true;
+	}
+	return true;
+}
+
+/* The timer only requests the flush (no I2C in the timer interrupt) - DS1307_NVRAMCache_Service() does it */
+uint8_t DS1307_NVRAMCache_StartPeriodicFlush(int32_t intervalMs)
+{
+	if(flushTimerRunning)
+	{
+		DS1307_NVRAMCache_StopPeriodicFlush();
+	}
+	if(!add_repeating_timer_ms(intervalMs, DS1307_NVRAMCache_TimerCallback, NULL, &flushTimer))
+	{
+		return STAUS_FAILURE;
+	}
+	flushTimerRunning = true;
+
+	return STATUS_SUCCESS;
+}
+
+void DS1307_NVRAMCache_StopPeriodicFlush()
+{
+	if(flushTimerRunning)
+	{
+		cancel_repeating_timer(&flushTimer);
+		flushTimerRunning = false;
+	}
+}
+
+/* Call periodically from thread context */
+uint8_t DS1307_NVRAMCache_Service()
+{
+	if(!flushRequested)
+	{
+		return STATUS_SUCCESS;
+	}
+
+	return DS1307_NVRAMCache_Flush();
+}
+
+/** To be called from the application's power-fail GPIO interrupt. Flushes right away with blocking transfers - 
+ *  the DS1307 switches to the backup supply on its own, the data only has to reach it before the MCU dies.
+ *  If the interrupt preempted a flush, the controller is in the middle of that flush's transfer - nothing is sent 
+ *  from here, the running flush writes the remaining dirty bytes once the interrupt returns (STATUS_BUSY).
+ *  (Other blocking transfers of the application on the same bus are not guarded - mask this interrupt around them.)
+*/
+uint8_t DS1307_NVRAMCache_PowerFailFlush()
+{
+	DS1307_NVRAMCache_StopPeriodicFlush();
+
+	if(flushInProgress)
+	{
+		powerFailPending = true;
+		return STATUS_BUSY;
+	}
+
+	return DS1307_NVRAMCache_Flush();
+}
@@ -0,0 +1,230 @@
+/**
+ * Oscillator start-up detection - replaces the fixed 2s sleep after clearing the CH bit.
+ * 
+ * After CH is cleared the crystal needs some time to start and the first seconds increment follows up to 1s later.
+ * Two ways to find out that the clock really ticks:
+ * - Polling (sqwGpio = DS1307_OSC_SQW_NOT_USED): the seconds register is read every DS1307_OSC_POLL_INTERVAL_MS
+ *   until it changes - ready at the first increment (< 1s after the crystal runs).
+ * - SQW: the SQW/OUT pin is switched to 4.096kHz and the edges of its GPIO (input with pull-up, SQW/OUT is open 
+ *   drain) are counted until DS1307_OSC_SQW_EDGES were seen - ready within a few ms of the crystal running.
+ *   The edges come from the IO_BANK0 raw interrupt status (INTR EDGE_HIGH/EDGE_LOW), which latches them in 
+ *   hardware whether the interrupt is enabled or not - sampling the level at the Service() rate would alias with 
+ *   the 244us period and can see "no change" from a running oscillator. No interrupt handler, no I2C traffic 
+ *   while waiting. The previous control register value is restored afterwards.
+ * If the oscillator is already running (CH = 0, e.g. a warm boot with the backup battery) it is ready immediately.
+ * 
+ * DS1307_Dev_StartOscillatorAsync() returns right away and DS1307_Oscillator_Service(), called from the init loop 
+ * in between other work, advances the detection (STATUS_BUSY until done) - no I2C in interrupts. 
+ * DS1307_Dev_WaitOscillatorReady() is the blocking version. One detection at a time.
+*/
+
+#include "pico/stdlib.h"
+#include "hardware/gpio.h"
+#include "hardware/structs/iobank0.h"
+#include "DS1307.h"
+#include "DS1307_Oscillator.h"
+#include "I2C_Driver.h"
+#include "DS1307_Log.h"
+
+#define GPIO_IRQ_EVENTS_PER_REG		8 /* IO_BANK0 INTRx: 4 event bits for each of 8 GPIOs */
+#define GPIO_IRQ_EVENT_BITS			4
+#define OSC_SQW_EDGE_EVENTS			(GPIO_IRQ_EDGE_FALL | GPIO_IRQ_EDGE_RISE)
+
+typedef enum
+{
+	OSC_STATE_IDLE = 0,
+	OSC_STATE_POLLING,
+	OSC_STATE_SQW
+} DS1307_OscState_t;
+
+static DS1307_OscState_t oscState = OSC_STATE_IDLE;
+static I2C_Device_t *oscRtc;
+static uint32_t oscSqwGpio;
+static absolute_time_t oscDeadline;
+static absolute_time_t oscNextPoll;
+static uint8_t oscFirstSeconds;
+static bool oscFirstSecondsValid;
+static uint32_t oscEdges;
+static uint8_t oscSavedControl;
+static DS1307_OscReadyCallback_t oscCallback;
+static void *oscContext;
+
+/* Edges of the SQW GPIO latched since the last call (0-2: at least one falling and/or rising edge), cleared */
+static uint32_t DS1307_Oscillator_TakeSqwEdges()
+{
+	uint32_t eventShift = GPIO_IRQ_EVENT_BITS * (oscSqwGpio % GPIO_IRQ_EVENTS_PER_REG);
+	uint32_t events = (io_bank0_hw->intr[oscSqwGpio / GPIO_IRQ_EVENTS_PER_REG] >> eventShift) & OSC_SQW_EDGE_EVENTS;
+
+	if(events == 0)
+	{
+		return 0;
+	}
+	gpio_acknowledge_irq(oscSqwGpio, events);
+	return (events == OSC_SQW_EDGE_EVENTS) ? 2 : 1;
+}
+
+static uint8_t DS1307_Oscillator_Finish(uint8_t status)
+{
+	if(oscState == OSC_STATE_SQW)
+	{
+		/* Give the SQW/OUT pin back in the state it had before */
+		if(DS1307_Dev_SetControl(oscRtc, oscSavedControl) != STATUS_SUCCESS)
+		{
+			status = STAUS_FAILURE;
+		}
+	}
+	oscState = OSC_STATE_IDLE;
+
+	if(status == STATUS_SUCCESS)
+	{
+		LOG_INFO("Oscillator running \n");
+	}
+	else
+	{
+		LOG_ERROR("Oscillator didn't start \n");
+	}
+	if(oscCallback != NULL)
+	{
+		oscCallback(status, oscContext);
+	}
+	return status;
+}
+
+/** Clear CH and start watching for the oscillator - the result comes from DS1307_Oscillator_Service()/the callback.
+ *  Returns STATUS_BUSY if a detection is already running, an error if the RTC can't be accessed.
+*/
+uint8_t DS1307_Dev_StartOscillatorAsync(I2C_Device_t *rtc, uint32_t sqwGpio, uint32_t timeoutMs, 
+										DS1307_OscReadyCallback_t callback, void *context)
+{
+	bool halted;
+
+	if(oscState != OSC_STATE_IDLE)
+	{
+		return STATUS_BUSY;
+	}
+
+	oscRtc = rtc;
+	oscSqwGpio = sqwGpio;
+	oscCallback = callback;
+	oscContext = context;
+	oscDeadline = make_timeout_time_ms(timeoutMs);
+
+	if(DS1307_Dev_IsOscillatorHalted(rtc, &halted) != STATUS_SUCCESS)
+	{
+		return MPU6050_REGISTER_I2C_READ_FAIL;
+	}
+	if(!halted)
+	{
+		/* Already running - reported by the next Service() call, like every other result (no register read) */
+		oscState = OSC_STATE_POLLING;
+		oscEdges = DS1307_OSC_SQW_EDGES;
+		oscNextPoll = at_the_end_of_time;
+		return STATUS_SUCCESS;
+	}
+
+	if(sqwGpio != DS1307_OSC_SQW_NOT_USED)
+	{
+		if(DS1307_Dev_GetControl(rtc, &oscSavedControl) != STATUS_SUCCESS) 
+		{
+			return MPU6050_REGISTER_I2C_READ_FAIL;
+		}
+		if(DS1307_Dev_EnableSquareWaveOutput(rtc, CONTROL_REG_RS_4096HZ) != STATUS_SUCCESS)
+		{
+			return MPU6050_REGISTER_I2C_READ_FAIL;
+		}
+		gpio_init(sqwGpio);
+		gpio_set_dir(sqwGpio, GPIO_IN);
+		gpio_pull_up(sqwGpio);
+		oscEdges = 0;
+	}
+
+	if(DS1307_Dev_EnableOscillator(rtc) != STATUS_SUCCESS)
+	{
+		if(sqwGpio != DS1307_OSC_SQW_NOT_USED)
+		{
+			(void)DS1307_Dev_SetControl(rtc, oscSavedControl);
+		}
+		return MPU6050_REGISTER_I2C_READ_FAIL;
+	}
+
+	oscState = (sqwGpio != DS1307_OSC_SQW_NOT_USED) ? OSC_STATE_SQW : OSC_STATE_POLLING;
+	oscFirstSecondsValid = false;
+	oscEdges = 0;
+	oscNextPoll = get_absolute_time();
+	if(oscState == OSC_STATE_SQW)
+	{
+		/* Drop edges latched before the oscillator was enabled (pin setup, pull-up) */
+		gpio_acknowledge_irq(sqwGpio, OSC_SQW_EDGE_EVENTS);
+	}
+
+	return STATUS_SUCCESS;
+}
+
+/** Advance the detection - never blocks (at most one single register read).
+ *  Returns STATUS_BUSY while waiting, then once STATUS_SUCCESS (running) or STAUS_FAILURE (timeout), 
+ *  STATUS_SUCCESS also when no detection was started.
+*/
+uint8_t DS1307_Oscillator_Service()
+{
+	if(oscState == OSC_STATE_IDLE)
+	{
+		return STATUS_SUCCESS;
+	}
+
+	if(oscState == OSC_STATE_SQW)
+	{
+		oscEdges += DS1307_Oscillator_TakeSqwEdges();
+	}
+	else if(absolute_time_diff_us(get_absolute_time(), oscNextPoll) <= 0)
+	{
+		uint8_t seconds = I2C_Dev_Register_Read(oscRtc, DS1307_REG_SECONDS);
+		oscNextPoll = make_timeout_time_ms(DS1307_OSC_POLL_INTERVAL_MS);
+
+		if(I2C_Bus_GetLastError(oscRtc->bus, NULL) == I2C_ERROR_NONE)
+		{
+			if(!oscFirstSecondsValid)
+			{
+				oscFirstSeconds = seconds;
+				oscFirstSecondsValid = true;
+			}
+			else if(seconds != oscFirstSeconds)
+			{
+				oscEdges = DS1307_OSC_SQW_EDGES; /* The seconds counted - running */
+			}
+		}
+	}
+
+	if(oscEdges >= DS1307_OSC_SQW_EDGES)
+	{
+		return DS1307_Oscillator_Finish(STATUS_SUCCESS);
+	}
+	if(absolute_time_diff_us(get_absolute_time(), oscDeadline) <= 0)
+	{
+		return DS1307_Oscillator_Finish(STAUS_FAILURE);
+	}
+
+	return STATUS_BUSY;
+}
+
+/* Blocking: enable the oscillator and return as soon as it runs (or after timeoutMs) */
+uint8_t DS1307_Dev_WaitOscillatorReady(I2C_Device_t *rtc, uint32_t sqwGpio, uint32_t timeoutMs)
+{
+	uint8_t status = DS1307_Dev_StartOscillatorAsync(rtc, sqwGpio, timeoutMs, NULL, NULL);
+
+	if(status != STATUS_SUCCESS)
+	{
+		return status;
+	}
+	while((status = DS1307_Oscillator_Service()) == STATUS_BUSY)
+	{
+		tight_loop_contents();
+	}
+
+	return status;
+}
+
+/* Enable the oscillator and wait until it runs (polling the seconds, at most DS1307_OSC_READY_TIMEOUT_MS) */
+uint8_t Enable_DS1307_Oscillator() 
+{
+	return DS1307_Dev_WaitOscillatorReady(&I2C_DefaultDevice, DS1307_OSC_SQW_NOT_USED, DS1307_OSC_READY_TIMEOUT_MS);
+}
@@ -0,0 +1,137 @@
+/**
+ * Single owner of the DS1307 for dual-core applications.
+ * 
+ * Nothing keeps core 0 and core 1 from interleaving the register pointer write and the read of two transfers on the 
+ * same bus, so only one context - the owner - talks to the DS1307. It reads the timekeeper block periodically and 
+ * publishes the decoded date/time through a seqlock (DS1307_TimeChannel.h). Readers on either core get a consistent 
+ * snapshot with DS1307_Owner_GetDateTime() without a spin lock and without touching the bus.
+ * 
+ * The owner is either:
+ * - core 1: DS1307_Owner_LaunchCore1() starts a loop on core 1 doing blocking burst reads (or call 
+ *   DS1307_Owner_Core1Loop() from an own core 1 entry), or
+ * - an interrupt: DS1307_Owner_StartIrq() submits a queued burst read from a repeating timer and publishes from the 
+ *   transfer completion callback (I2C_IRQ_Initialize(&I2C_DefaultBus) must be called first).
+ * In both cases the application must not access the DS1307 directly anymore.
+*/
+
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "DS1307.h"
+#include "DS1307_Owner.h"
+#include "DS1307_TimeChannel.h"
+#include "I2C_Driver.h"
+#include "I2C_IRQ.h"
+
+static DS1307_TimeChannel_t timeChannel;
+static uint32_t core1RefreshIntervalMs = DS1307_OWNER_DEFAULT_REFRESH_MS;
+static repeating_timer_t refreshTimer;
+static bool refreshTimerRunning = false;
+static uint8_t irqTimekeeperRegs_au8[DS1307_TIMEKEEPER_REGS_LENGTH];
+static volatile bool irqReadPending = false;
+
+void DS1307_Owner_Core1Loop()
+{
+	DS1307_DateTime_t dateTime;
+
+	while(true)
+	{
+		if(DS1307_ReadDateTime(&dateTime) == STATUS_SUCCESS)
+		{
+			DS1307_TimeChannel_Publish(&timeChannel, &dateTime);
+		}
+		sleep_ms(core1RefreshIntervalMs);
+	}
+}
+
+/* Core 1 becomes the owner - it must not be used for anything else */
+uint8_t DS1307_Owner_LaunchCore1(uint32_t refreshIntervalMs)
+{
+	core1RefreshIntervalMs = (refreshIntervalMs > 0) ? refreshIntervalMs : DS1307_OWNER_DEFAULT_REFRESH_MS;
+	multicore_launch_core1(DS1307_Owner_Core1Loop);
+
+	return STATUS_SUCCESS;
+}
+
+static void DS1307_Owner_ReadComplete(uint8_t status, void *context)
+{
+	(void)context;
+
+	if(status == STATUS_SUCCESS)
+	{
+		DS1307_DateTime_t dateTime;
+		DS1307_DecodeDateTime(irqTimekeeperRegs_au8, &dateTime);
+		DS1307_TimeChannel_Publish(&timeChannel, &dateTime);
+	}
+	irqReadPending = false;
+}
+
+static bool DS1307_Owner_TimerCallback(repeating_timer_t *timer)
+{
+	(void)timer;
+
+	/* Skip this period if the previous read is still queued (e.g. a busy bus) */
+	if(!irqReadPending)
+	{
+		const I2C_Transfer_t transfer = {
+			.isRead = I2C_TRANSFER_READ,
+			.device = &I2C_DefaultDevice,
+			.startRegisterAddress = DS1307_REG_SECONDS,
+			.buffer = irqTimekeeperRegs_au8,
+			.length = sizeof(irqTimekeeperRegs_au8),
+			.callback = DS1307_Owner_ReadComplete,
+			.context = NULL
+		};
+
+		irqReadPending = true;
+		if(I2C_IRQ_Submit(&transfer) != STATUS_SUCCESS)
+		{
+			irqReadPending = false;
+		}
+	}
+	return true;
+}
+
+/** Interrupts become the owner - the read is done by the I2C IRQ engine, the CPU only decodes the result.
+ *  'refreshIntervalMs' is the same as for DS1307_Owner_LaunchCore1(), 0 selects the default (up to INT32_MAX - the SDK
+ *  timer takes a signed delay, negative values mean something else there).
+*/
+uint8_t DS1307_Owner_StartIrq(uint32_t refreshIntervalMs)
+{
+	uint32_t intervalMs = (refreshIntervalMs > 0) ? refreshIntervalMs : DS1307_OWNER_DEFAULT_REFRESH_MS;
+
+	if(intervalMs > (uint32_t)INT32_MAX)
+	{
+		return STAUS_FAILURE;
+	}
+	if(refreshTimerRunning)
+	{
+		DS1307_Owner_StopIrq();
+	}
+	if(!add_repeating_timer_ms((int32_t)intervalMs, DS1307_Owner_TimerCallback, NULL, &refreshTimer))
+	{
+		return STAUS_FAILURE;
+	}
+	refreshTimerRunning = true;
+
+	return STATUS_SUCCESS;
+}
+
+void DS1307_Owner_StopIrq()
+{
+	if(refreshTimerRunning)
+	{
+		cancel_repeating_timer(&refreshTimer);
+		refreshTimerRunning = false;
+	}
+}
+
+/* Lock-free snapshot of the last published date/time - STAUS_FAILURE if the owner didn't publish anything yet */
+uint8_t DS1307_Owner_GetDateTime(DS1307_DateTime_t *dateTime)
+{
+	return (DS1307_TimeChannel_Read(&timeChannel, dateTime) != 0) ? STATUS_SUCCESS : STAUS_FAILURE;
+}
+
+uint32_t DS1307_Owner_GetPublishCount()
+{
+	return timeChannel.publishCount;
+}
@@ -0,0 +1,343 @@
+/**
+ * Non-blocking I2C transfers driven by the RP2040 DMA - Datasheet chapters 2.5 (DMA) and 4.3.8 (I2C DMA Controller Interface)
+ * 
+ * How it works:
+ * - Every entry written to IC_DATA_CMD is a 16-bit command: bits 7:0 hold the data to send, bit 8 (CMD) selects a read,
+ *   bit 9 (STOP) issues a STOP after the byte and bit 10 (RESTART) issues a RESTART before it.
+ * - The whole transfer (register pointer, data or read commands) is prepared in a command buffer and a TX DMA channel 
+ *   pushes it into the TX FIFO, paced by the I2C TX DREQ. For reads a second (RX) DMA channel empties the RX FIFO into 
+ *   the user buffer, paced by the I2C RX DREQ.
+ * - The end of the transfer is signalled by the STOP_DET interrupt (or TX_ABRT on error). The callback is called and 
+ *   the status flag is updated from the interrupt, so the CPU is not involved in moving the data at all.
+ * 
+ * Both controllers can run DMA transfers in parallel - every controller has its own state and DMA channels.
+ * Starting and ending a transfer (busy flag) is guarded by a hardware spin lock - the *_Async functions can be 
+ * called from both cores and from completion callbacks. After a TX_ABRT the STOP that follows is waited for 
+ * (bounded), so its STOP_DET can't end the next transfer early.
+ * 
+ * Note: buffers passed to the *_Async functions must stay valid until the transfer completes (or I2C_DMA_Cancel()).
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/address_mapped.h"
+#include "hardware/i2c.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#include "I2C_Driver.h"
+#include "I2C_DMA.h"
+
+/* State of the DMA transfers of one controller */
+typedef struct
+{
+	i2c_inst_t *instance;
+	I2C_Bus_t *bus;
+	/* Register pointer + data/read commands for the longest possible burst */
+	uint16_t commandBuffer[I2C_BURST_MAX_LENGTH + 1];
+	int txChannel;
+	int rxChannel;
+	volatile bool transferBusy;		/* Claimed - from the start until the callback */
+	volatile bool transferEnding;	/* Completion (STOP/abort/cancel) in progress - only its owner touches the state */
+	volatile bool transferIsRead;
+	volatile uint8_t transferStatus;
+	I2C_TransferCallback_t transferCallback;
+	void *transferContext;
+} I2C_DMA_State_t;
+
+static I2C_DMA_State_t dmaState[I2C_CONTROLLER_COUNT] = 
+{
+	{ .txChannel = -1, .rxChannel = -1, .transferStatus = STATUS_SUCCESS },
+	{ .txChannel = -1, .rxChannel = -1, .transferStatus = STATUS_SUCCESS },
+};
+
+static spin_lock_t *dmaLock = NULL; /* Claimed by the first I2C_DMA_Initialize() */
+
+static I2C_DMA_State_t *I2C_DMA_GetState(const I2C_Bus_t *bus)
+{
+	return &dmaState[i2c_hw_index(bus->instance)];
+}
+
+/* Test-and-set of the busy flag - false if a transfer is already running on the bus */
+static bool I2C_DMA_Claim(I2C_DMA_State_t *state)
+{
+	uint32_t lockState = spin_lock_blocking(dmaLock);
+	bool claimed = !state->transferBusy;
+
+	if(claimed)
+	{
+		state->transferBusy = true;
+		state->transferEnding = false;
+	}
+	spin_unlock(dmaLock, lockState);
+	return claimed;
+}
+
+/** Take over the completion of the running transfer - only one of the interrupt and I2C_DMA_Cancel() wins. 
+ *  'context' must match unless 'anyContext'.
+*/
+static bool I2C_DMA_BeginEnd(I2C_DMA_State_t *state, bool anyContext, const void *context)
+{
+	uint32_t lockState = spin_lock_blocking(dmaLock);
+	bool owner = state->transferBusy && !state->transferEnding && (anyContext || (state->transferContext == context));
+
+	if(owner)
+	{
+		state->transferEnding = true;
+	}
+	spin_unlock(dmaLock, lockState);
+	return owner;
+}
+
+/* Called by the owner of the completion (see I2C_DMA_BeginEnd()) - the bus can be claimed again before the callback */
+static void I2C_DMA_CompleteTransfer(I2C_DMA_State_t *state, uint8_t status)
+{
+	i2c_hw_t *regs = i2c_get_hw(state->instance);
+
+	/* Keep the interrupts masked until the next transfer is started */
+	regs->intr_mask = 0;
+	regs->dma_cr = 0;
+
+	I2C_TransferCallback_t callback = state->transferCallback;
+	void *context = state->transferContext;
+
+	state->transferStatus = status;
+	state->transferEnding = false;
+	state->transferBusy = false;
+
+	if(callback != NULL)
+	{
+		callback(status, context);
+	}
+}
+
+static void I2C_DMA_HandleInterrupt(I2C_DMA_State_t *state)
+{
+	if(!state->transferBusy)
+	{
+		return; /* Not our transfer (the I2C IRQ is shared) */
+	}
+
+	i2c_hw_t *regs = i2c_get_hw(state->instance);
+	if(state->transferEnding)
+	{
+		regs->intr_mask = 0; /* I2C_DMA_Cancel() preempted - it ends the transfer, don't keep interrupting it */
+		return;
+	}
+	uint32_t interruptStatus = regs->intr_stat;
+
+	if(interruptStatus & I2C_IC_INTR_STAT_R_TX_ABRT_BITS)
+	{
+		if(!I2C_DMA_BeginEnd(state, true, NULL))
+		{
+			regs->intr_mask = 0; /* Being cancelled */
+			return;
+		}
+		/* Slave NACK / arbitration lost - the controller flushed its FIFOs, stop feeding it */
+		regs->intr_mask = 0;
+		dma_channel_abort((uint)state->txChannel);
+		dma_channel_abort((uint)state->rxChannel);
+		(void)regs->clr_tx_abrt;
+		(void)I2C_Bus_CompleteAbort(state->bus); /* The STOP follows the abort */
+		I2C_DMA_CompleteTransfer(state, MPU6050_REGISTER_I2C_READ_FAIL);
+	}
+	else if(interruptStatus & I2C_IC_INTR_STAT_R_STOP_DET_BITS)
+	{
+		if(!I2C_DMA_BeginEnd(state, true, NULL))
+		{
+			regs->intr_mask = 0;
+			return;
+		}
+		(void)regs->clr_stop_det;
+		if(state->transferIsRead)
+		{
+			/* The last byte may still be on its way from the RX FIFO to memory */
+			while(dma_channel_is_busy((uint)state->rxChannel))
+			{
+				tight_loop_contents();
+			}
+		}
+		I2C_DMA_CompleteTransfer(state, STATUS_SUCCESS);
+	}
+}
+
+static void I2C0_DMA_IRQHandler()
+{
+	I2C_DMA_HandleInterrupt(&dmaState[0]);
+}
+
+static void I2C1_DMA_IRQHandler()
+{
+	I2C_DMA_HandleInterrupt(&dmaState[1]);
+}
+
+/* Select the device (speed/address) and set the DMA FIFO thresholds */
+static void I2C_DMA_PrepareBus(I2C_Device_t *device)
+{
+	i2c_hw_t *regs = i2c_get_hw(device->bus->instance);
+
+	I2C_Dev_Select(device);
+	regs->dma_tdlr = I2C_DMA_TX_FIFO_THRESHOLD;
+	regs->dma_rdlr = I2C_DMA_RX_FIFO_THRESHOLD;
+}
+
+static void I2C_DMA_StartTxChannel(I2C_DMA_State_t *state, size_t commandCount)
+{
+	i2c_hw_t *regs = i2c_get_hw(state->instance);
+	dma_channel_config config = dma_channel_get_default_config((uint)state->txChannel);
+
+	channel_config_set_transfer_data_size(&config, DMA_SIZE_16);
+	channel_config_set_read_increment(&config, true);
+	channel_config_set_write_increment(&config, false);
+	channel_config_set_dreq(&config, i2c_get_dreq(state->instance, true));
+	dma_channel_configure((uint)state->txChannel, &config, &regs->data_cmd, state->commandBuffer, commandCount, true);
+}
+
+/* Must be called once per bus after the bus is initialized */
+uint8_t I2C_DMA_Initialize(I2C_Bus_t *bus)
+{
+	I2C_DMA_State_t *state = I2C_DMA_GetState(bus);
+	const uint32_t index = i2c_hw_index(bus->instance);
+
+	if(dmaLock == NULL)
+	{
+		dmaLock = spin_lock_init((uint)spin_lock_claim_unused(true));
+	}
+
+	state->instance = bus->instance;
+	state->bus = bus;
+	state->txChannel = dma_claim_unused_channel(false);
+	state->rxChannel = dma_claim_unused_channel(false);
+	if((state->txChannel < 0) || (state->rxChannel < 0))
+	{
+		return STAUS_FAILURE;
+	}
+
+	i2c_get_hw(bus->instance)->intr_mask = 0;
+	irq_add_shared_handler(I2C0_IRQ + index, (index == 0) ? I2C0_DMA_IRQHandler : I2C1_DMA_IRQHandler, 
+						   PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+	irq_set_enabled(I2C0_IRQ + index, true);
+
+	return STATUS_SUCCESS;
+}
+
+uint8_t I2C_DMA_Read_Async(I2C_Device_t *device, uint8_t startRegisterAddress, uint8_t *buffer, size_t length, I2C_TransferCallback_t callback, void *context)
+{
+	I2C_DMA_State_t *state = I2C_DMA_GetState(device->bus);
+	i2c_hw_t *regs = i2c_get_hw(device->bus->instance);
+
+	if((length == 0) || (length > I2C_BURST_MAX_LENGTH) || (state->rxChannel < 0))
+	{
+		return STAUS_FAILURE;
+	}
+	if(!I2C_DMA_Claim(state))
+	{
+		return STATUS_BUSY;
+	}
+
+	/* Register pointer write, then RESTART + 'length' read commands, STOP after the last one */
+	state->commandBuffer[0] = startRegisterAddress;
+	for(size_t i = 0; i < length; i++)
+	{
+		state->commandBuffer[i + 1] = I2C_IC_DATA_CMD_CMD_BITS;
+	}
+	state->commandBuffer[1] |= I2C_IC_DATA_CMD_RESTART_BITS;
+	state->commandBuffer[length] |= I2C_IC_DATA_CMD_STOP_BITS;
+
+	state->transferCallback = callback;
+	state->transferContext = context;
+	state->transferIsRead = true;
+	state->transferStatus = STATUS_BUSY;
+
+	I2C_DMA_PrepareBus(device);
+
+	dma_channel_config config = dma_channel_get_default_config((uint)state->rxChannel);
+	channel_config_set_transfer_data_size(&config, DMA_SIZE_8);
+	channel_config_set_read_increment(&config, false);
+	channel_config_set_write_increment(&config, true);
+	channel_config_set_dreq(&config, i2c_get_dreq(device->bus->instance, false));
+	dma_channel_configure((uint)state->rxChannel, &config, buffer, &regs->data_cmd, length, true);
+
+	/* No leftovers of an earlier transfer (blocking layer, other engine) may end this one */
+	(void)regs->clr_tx_abrt;
+	(void)regs->clr_stop_det;
+	regs->dma_cr = I2C_IC_DMA_CR_TDMAE_BITS | I2C_IC_DMA_CR_RDMAE_BITS;
+	regs->intr_mask = I2C_IC_INTR_MASK_M_STOP_DET_BITS | I2C_IC_INTR_MASK_M_TX_ABRT_BITS;
+	I2C_DMA_StartTxChannel(state, length + 1);
+
+	return STATUS_SUCCESS;
+}
+
+uint8_t I2C_DMA_Write_Async(I2C_Device_t *device, uint8_t startRegisterAddress, const uint8_t *data, size_t length, I2C_TransferCallback_t callback, void *context)
+{
+	I2C_DMA_State_t *state = I2C_DMA_GetState(device->bus);
+	i2c_hw_t *regs = i2c_get_hw(device->bus->instance);
+
+	if((length == 0) || (length > I2C_BURST_MAX_LENGTH) || (state->txChannel < 0))
+	{
+		return STAUS_FAILURE;
+	}
+	if(!I2C_DMA_Claim(state))
+	{
+		return STATUS_BUSY;
+	}
+
+	/* Register pointer followed by the data, STOP after the last byte */
+	state->commandBuffer[0] = startRegisterAddress;
+	for(size_t i = 0; i < length; i++)
+	{
+		state->commandBuffer[i + 1] = data[i];
+	}
+	state->commandBuffer[length] |= I2C_IC_DATA_CMD_STOP_BITS;
+
+	state->transferCallback = callback;
+	state->transferContext = context;
+	state->transferIsRead = false;
+	state->transferStatus = STATUS_BUSY;
+
+	I2C_DMA_PrepareBus(device);
+
+	(void)regs->clr_tx_abrt;
+	(void)regs->clr_stop_det;
+	regs->dma_cr = I2C_IC_DMA_CR_TDMAE_BITS;
+	regs->intr_mask = I2C_IC_INTR_MASK_M_STOP_DET_BITS | I2C_IC_INTR_MASK_M_TX_ABRT_BITS;
+	I2C_DMA_StartTxChannel(state, length + 1);
+
+	return STATUS_SUCCESS;
+}
+
+bool I2C_DMA_IsBusy(const I2C_Bus_t *bus)
+{
+	return I2C_DMA_GetState(bus)->transferBusy;
+}
+
+/* STATUS_BUSY while the transfer is ongoing, then STATUS_SUCCESS or MPU6050_REGISTER_I2C_READ_FAIL */
+uint8_t I2C_DMA_GetStatus(const I2C_Bus_t *bus)
+{
+	return I2C_DMA_GetState(bus)->transferStatus;
+}
+
+/** Stop the running transfer started with 'context' (e.g. its caller's deadline passed, SCL held low): 
+ *  DMA channels and controller aborted, the transfer completed with MPU6050_REGISTER_I2C_READ_FAIL - its callback 
+ *  is called from here, so every transfer still gets exactly one callback. 
+ *  STAUS_FAILURE if no such transfer is running (already completed).
+*/
+uint8_t I2C_DMA_Cancel(I2C_Bus_t *bus, void *context)
+{
+	I2C_DMA_State_t *state = I2C_DMA_GetState(bus);
+
+	if((dmaLock == NULL) || !I2C_DMA_BeginEnd(state, false, context))
+	{
+		return STAUS_FAILURE;
+	}
+
+	i2c_get_hw(bus->instance)->intr_mask = 0;
+	dma_channel_abort((uint)state->txChannel);
+	dma_channel_abort((uint)state->rxChannel);
+	I2C_Bus_AbortTransfer(bus);
+	(void)I2C_Bus_CompleteAbort(bus);
+	I2C_DMA_CompleteTransfer(state, MPU6050_REGISTER_I2C_READ_FAIL);
+
+	return STATUS_SUCCESS;
+}
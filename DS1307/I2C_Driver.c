@@ -9,31 +9,209 @@
 #include "hardware/clocks.h"
 #include "DS1307.h"
 #include "I2C_Driver.h"
+#include "DS1307_Log.h"
 
-i2c_hw_t *I2C0_Regs = I2C0_REGISTER_STRUCTURE;
-resets_hw_t *ResetCtrl_Regs = RESET_CONTROL_REGISTER_STRUCTURE;
+static resets_hw_t *const ResetCtrl_Regs = RESET_CONTROL_REGISTER_STRUCTURE;
 
-void Reset_I2C0()
+static i2c_hw_t *I2C_Regs(const I2C_Bus_t *bus)
+{
+	return i2c_get_hw(bus->instance);
+}
+
+void I2C_Bus_Reset(I2C_Bus_t *bus)
 {
-	hw_set_bits(&ResetCtrl_Regs->reset, RESETS_RESET_I2C0_BITS);
-	hw_clear_bits(&ResetCtrl_Regs->reset, RESETS_RESET_I2C0_BITS);
+	const uint32_t resetBits = (i2c_hw_index(bus->instance) == 0) ? RESETS_RESET_I2C0_BITS : RESETS_RESET_I2C1_BITS;
+
+	hw_set_bits(&ResetCtrl_Regs->reset, resetBits);
+	hw_clear_bits(&ResetCtrl_Regs->reset, resetBits);
 
 	/* Wait for the module to get out of the reset state */
-    while (~ResetCtrl_Regs->reset_done & RESETS_RESET_I2C0_BITS)
+    while (~ResetCtrl_Regs->reset_done & resetBits)
 	{
 		tight_loop_contents();
 	}
+	bus->activeTiming = NULL;
 }
 
-/* Perform initial configuration according to 4.3.10.2.1 and 4.3.14 Datasheet chapters */
-void I2C_Initialize(uint32_t baudrate) 
+void Reset_I2C0()
 {
+	I2C_Bus_Reset(&I2C_DefaultBus);
+}
+
+/** Timing requirements per I2C speed mode - I2C specification (UM10204) Table 10:
+ *  - Standard-mode (<=100kHz): LOW period of SCL >= 4.7us, HIGH period of SCL >= 4.0us, SDA hold 300ns
+ *  - Fast-mode (<=400kHz): LOW period of SCL >= 1.3us, HIGH period of SCL >= 0.6us, SDA hold 300ns
+ *  - Fast-mode Plus (<=1MHz): LOW period of SCL >= 0.5us, HIGH period of SCL >= 0.26us, SDA hold 120ns
+ *  Spikes up to 50ns must be suppressed in Fast-mode and Fast-mode Plus (also used for Standard-mode).
+ *  The DW_apb_i2c has no separate FM+ mode - FM+ uses the fast mode (FS) registers with shorter counts.
+*/
+typedef struct
+{
+	uint32_t maxBaudrate;
+	uint32_t speedMode;
+	uint32_t minLowNs;
+	uint32_t minHighNs;
+	uint32_t sdaHoldNs;
+	uint32_t spikeNs;
+} I2C_SpeedModeTiming_t;
+
+static const I2C_SpeedModeTiming_t I2C_TimingTable[] = 
+{
+	{ I2C_STANDARD_MODE,  I2C_IC_CON_SPEED_VALUE_STANDARD, 4700, 4000, 300, 50 },
+	{ I2C_FAST_MODE,      I2C_IC_CON_SPEED_VALUE_FAST,     1300,  600, 300, 50 },
+	{ I2C_FAST_MODE_PLUS, I2C_IC_CON_SPEED_VALUE_FAST,      500,  260, 120, 50 },
+};
+
+/* Number of clk_sys cycles covering 'ns' nanoseconds (rounded up) */
+static uint32_t I2C_NsToCycles(uint32_t clockFreq, uint32_t ns)
+{
+	return (uint32_t)((((uint64_t)clockFreq * ns) + 999999999u) / 1000000000u);
+}
+
+/** Compute the controller timing for 'baudrate' from the current clk_sys frequency.
+ *  The result can be computed once per device and applied with I2C_Bus_ApplyTiming() whenever the bus is switched 
+ *  to that device - no need to re-initialize the controller. Baudrates above 1MHz are clamped to FM+ limits.
+*/
+void I2C_ComputeTiming(uint32_t baudrate, I2C_Timing_t *timing)
+{
+	const size_t modeCount = sizeof(I2C_TimingTable) / sizeof(I2C_TimingTable[0]);
+	const I2C_SpeedModeTiming_t *mode = &I2C_TimingTable[modeCount - 1];
+
+	for(size_t i = 0; i < modeCount; i++)
+	{
+		if(baudrate <= I2C_TimingTable[i].maxBaudrate)
+		{
+			mode = &I2C_TimingTable[i];
+			break;
+		}
+	}
+	if(baudrate > mode->maxBaudrate)
+	{
+		baudrate = mode->maxBaudrate;
+	}
+
+    /* I2C is supplied from the clk_sys clock, which is by default 125MHz (8ns period) - Datasheet 4.3.14.2 */
+    uint32_t clockFreq = clock_get_hz(clk_sys); 
+	/** Period of the SCL signal in clk_sys cycles, e.g. for fast mode (1/400kHz=2.5us) it's 313 cycles at 125MHz 
+	 *  (baudrate/2 added to avoid division truncation) 
+	*/
+	uint32_t period_SCL = (clockFreq + (baudrate/2))/baudrate;
+
+	/** Spike suppression - Datasheet Chapter 4.3.11
+	 *  IC_FS_SPKLEN holds the maximum spike length for SS and FS modes (in ic_clk cycles), it must be at least 1
+	*/
+	uint32_t spklen = I2C_NsToCycles(clockFreq, mode->spikeNs);
+	if(spklen < 1)
+	{
+		spklen = 1;
+	}
+
+	/** Datasheet Chapter 4.3.14
+	 *  Split the period 3/5 LOW, 2/5 HIGH, then make sure both meet the minimums of the speed mode and of the 
+	 *  controller (LCNT > IC_FS_SPKLEN + 7, HCNT > IC_FS_SPKLEN + 5). If the minimums don't fit into the requested 
+	 *  period the bus simply runs a bit slower than requested - it never runs out of spec.
+	*/
+	uint32_t minLcnt = I2C_NsToCycles(clockFreq, mode->minLowNs);
+	uint32_t minHcnt = I2C_NsToCycles(clockFreq, mode->minHighNs);
+	if(minLcnt < (spklen + 8))
+	{
+		minLcnt = spklen + 8;
+	}
+	if(minHcnt < (spklen + 6))
+	{
+		minHcnt = spklen + 6;
+	}
+
+	uint32_t lcnt = (period_SCL * 3/5);
+	if(lcnt < minLcnt)
+	{
+		lcnt = minLcnt;
+	}
+	uint32_t hcnt = (period_SCL > lcnt) ? (period_SCL - lcnt) : 0;
+	if(hcnt < minHcnt)
+	{
+		hcnt = minHcnt;
+	}
+
+	/** Per I2C-bus specification a device must internally provide a hold time for the SDA signal to bridge 
+	 *  the undefined region of the falling edge of SCL (300ns for SS/FS, 120ns for FM+). The hold time must 
+	 *  also be shorter than the LOW period (Datasheet 4.3.14: IC_SDA_TX_HOLD < IC_FS_SCL_LCNT - 2).
+	*/
+	uint32_t sdaHold = I2C_NsToCycles(clockFreq, mode->sdaHoldNs) + 1;
+	if(sdaHold > (lcnt - 2))
+	{
+		sdaHold = lcnt - 2;
+	}
+
+	timing->speedMode = mode->speedMode;
+	timing->hcnt = hcnt;
+	timing->lcnt = lcnt;
+	timing->spklen = spklen;
+	timing->sdaHold = sdaHold;
+}
+
+/* Switch the bus timing (e.g. to the speed of the next device on a shared bus) - the controller must be idle */
+void I2C_Bus_ApplyTiming(I2C_Bus_t *bus, const I2C_Timing_t *timing)
+{
+	i2c_hw_t *regs = I2C_Regs(bus);
+
+	/* Timing registers can only be written while the controller is disabled */
+	regs->enable = 0;
+
+	hw_write_masked(&regs->con, timing->speedMode << I2C_IC_CON_SPEED_LSB, I2C_IC_CON_SPEED_BITS);
+	if(timing->speedMode == I2C_IC_CON_SPEED_VALUE_STANDARD)
+	{
+		regs->ss_scl_hcnt = timing->hcnt;
+		regs->ss_scl_lcnt = timing->lcnt;
+	}
+	else
+	{
+		regs->fs_scl_hcnt = timing->hcnt;
+		regs->fs_scl_lcnt = timing->lcnt;
+	}
+	/* IC_FS_SPKLEN is used for both SS and FS (Datasheet 4.3.11) */
+	regs->fs_spklen = timing->spklen;
+    hw_write_masked(&regs->sda_hold,
+                    timing->sdaHold << I2C_IC_SDA_HOLD_IC_SDA_TX_HOLD_LSB,
+                    I2C_IC_SDA_HOLD_IC_SDA_TX_HOLD_BITS);
+
+	regs->enable = 1;
+	bus->activeTiming = timing;
+}
+
+/** Make 'timing' the default of the default bus (kept over I2C_Bus_Suspend()/Resume()). I2C_DefaultBus.baudrate 
+ *  follows - the SCL rate of the HIGH and LOW counts at the current clk_sys frequency.
+*/
+void I2C_ApplyTiming(const I2C_Timing_t *timing)
+{
+	I2C_DefaultBus.timing = *timing;
+	I2C_DefaultBus.baudrate = clock_get_hz(clk_sys) / (timing->hcnt + timing->lcnt);
+	I2C_Bus_ApplyTiming(&I2C_DefaultBus, &I2C_DefaultBus.timing);
+}
+
+/* Convenience wrapper - compute and apply the timing for 'baudrate' in one go (the new default bus speed) */
+void I2C_SetBaudrate(uint32_t baudrate)
+{
+	I2C_Timing_t timing;
+
+	I2C_ComputeTiming(baudrate, &timing);
+	I2C_ApplyTiming(&timing);
+	I2C_DefaultBus.baudrate = baudrate;
+}
+
+/** Perform initial configuration according to 4.3.10.2.1 and 4.3.14 Datasheet chapters.
+ *  Programs bus->timing, which the caller has set up (I2C_ComputeTiming() at init, the saved one on resume).
+*/
+static void I2C_Configure(I2C_Bus_t *bus) 
+{
+	i2c_hw_t *regs = I2C_Regs(bus);
+
 	/* Disable the DW_apb_i2c device - only then it can be configured */
-    I2C0_Regs->enable = 0;
+    regs->enable = 0;
 
-	/* Configure I2C0 with the following options: 
-	 * MASTER, FAST MODE, 7-BIT ADDRESSING, RESTART COND ENABLED, DEFAULT TX_EMPTY INTERRUPT */
-    I2C0_Regs->con =
+	/* Configure the controller with the following options: 
+	 * MASTER, FAST MODE (speed is set below), 7-BIT ADDRESSING, RESTART COND ENABLED, DEFAULT TX_EMPTY INTERRUPT */
+    regs->con =
 			(
 				(I2C_IC_CON_MASTER_MODE_BITS | I2C_IC_CON_IC_SLAVE_DISABLE_BITS) |
 				(I2C_IC_CON_SPEED_VALUE_FAST << I2C_IC_CON_SPEED_LSB) |
@@ -43,122 +221,320 @@ void I2C_Initialize(uint32_t baudrate)
 				I2C_IC_CON_RX_FIFO_FULL_HLD_CTRL_VALUE_DISABLED
 			);
 
-	/* Frequency/Timing Configuration: (TODO - rework the timing) */ 
-    /* I2C is supplied from the clk_sys clock, which is by default 125MHz (8ns period) - Datasheet 4.3.14.2 */
-    uint32_t clockFreq = clock_get_hz(clk_sys); 
-	/** Period of the SCL signal for I2C fast mode (1/400kHz=2.5us) is equal to 313 clk_sys cycles (approx.) 
-	 *  we find that by calculating the ratio of clk_sys freq to baudrate (I2C freq) - it gives us info on 
-	 *  how many clk_sys cycles there are per one baudrate cycle (baudrate/2 added to avoid division truncation) 
-	*/
-	uint32_t period_SCL = (clockFreq + (baudrate/2))/baudrate;
+	/* Speed mode, SCL high/low counts, spike suppression and SDA hold (re-enables the controller) */
+	I2C_Bus_ApplyTiming(bus, &bus->timing);
+}
 
-	/** Datasheet Chapter 4.3.14
-	 * 	High and low counts (how long to hold high/low state of SCL during START, STOP and RESTART commands?)
-	 * 
-	 *  Low count value (FS_SCL_LCNT) must be larger than IC_FS_SPKLEN + 7 (Spike Suppression Limit Value) 
-	 *  High count value (FS_SCL_HCNT) register values must be larger than IC_FS_SPKLEN + 5 
-	 * 
-	 * We divide the period_SCL (313 cycles (of clk_sys !)) between HCNT and LCNT - which makes sense, we decide 
-	 * how long we hold HIGH and LOW during one I2C cycle
-	 * According to I2C specification (Table 11):
-	 * - min LOW period of SCL clock for Fast-mode: 0.6us (600ns)
-	 * - min HIGH period of SCL clock for Fast-mode: 1.3us (1300ns)
-	*/
-    uint32_t lcnt = (period_SCL * 3/5); /* 187 cycles (~1500ns)  */
-    uint32_t hcnt = period_SCL - lcnt; /* 126 cycles (~1000ns) */
+static void I2C_SetupPins(const I2C_Bus_t *bus)
+{
+    gpio_set_function(bus->sdaPin, GPIO_FUNC_I2C);
+    gpio_set_function(bus->sclPin, GPIO_FUNC_I2C);
+    gpio_pull_up(bus->sdaPin);
+    gpio_pull_up(bus->sclPin);
+}
 
-    I2C0_Regs->fs_scl_hcnt = hcnt;
-    I2C0_Regs->fs_scl_lcnt = lcnt;
+/** Bring up a controller: reset, configure for 'baudrate' and route it to the given pins 
+ *  (the pins must be valid I2C pins of that controller - see RP2040 Datasheet 1.4.3 GPIO Functions).
+*/
+void I2C_Bus_Init(I2C_Bus_t *bus, i2c_inst_t *instance, uint32_t sdaPin, uint32_t sclPin, uint32_t baudrate)
+{
+	const I2C_RetryPolicy_t defaultPolicy = I2C_DEFAULT_RETRY_POLICY;
 
-	/** Spike suppression - Datasheet Chapter 4.3.11
-	 *  The I2C Bus Specification calls for different maximum spike lengths (Table 10) according to the 
-	 *  operating mode — 50ns for SS and FS, so this register is required to store the values needed. 
-	 *  Register IC_FS_SPKLEN holds the maximum spike length for SS and FS modes (in ic_clk cycles) 
-	 *  The default value for these registers is based on the value of 100ns for ic_clk period, 
-	 *  so should be updated for the clk_sys period in use on RP2040
-	 */
-    I2C0_Regs->fs_spklen = CLK_SYS_88NS_IN_CYCLES;
-
-#ifdef UNDERSTOOD
-    // Per I2C-bus specification a device in standard or fast mode must
-    // internally provide a hold time of at least 300ns for the SDA signal to
-    // bridge the undefined region of the falling edge of SCL. A smaller hold
-    // time of 120ns is used for fast mode plus.
-    uint32_t sda_tx_hold_count;
-
-	// sda_tx_hold_count = clockFreq [cycles/s] * 300ns * (1s / 1e9ns)
-	// Reduce 300/1e9 to 3/1e7 to avoid numbers that don't fit in uint32_t.
-	// Add 1 to avoid division truncation.
-	sda_tx_hold_count = (((clockFreq * 3) / 10000000) + 1);
-
-    hw_write_masked(&I2C0_Regs->sda_hold,
-                    sda_tx_hold_count << I2C_IC_SDA_HOLD_IC_SDA_TX_HOLD_LSB,
-                    I2C_IC_SDA_HOLD_IC_SDA_TX_HOLD_BITS);
-#endif
-	/* Re-enable I2C0 controller */
-    I2C0_Regs->enable = 1;
+	bus->instance = instance;
+	bus->sdaPin = sdaPin;
+	bus->sclPin = sclPin;
+	bus->baudrate = baudrate;
+	bus->retryPolicy = defaultPolicy;
+	bus->lastError = I2C_ERROR_NONE;
+	bus->lastAbortSource = 0;
+	bus->backend = NULL;
+	bus->backendContext = NULL;
+	I2C_Bus_ResetStats(bus);
 
+	I2C_ComputeTiming(baudrate, &bus->timing);
+	I2C_Bus_Reset(bus);
+	I2C_Configure(bus);
+	I2C_SetupPins(bus);
 }
 
-uint8_t I2C_Register_Read(uint8_t registerAddress) 
+/* 'baudrate' = 0 - the device runs at the bus baudrate. Otherwise the bus is switched to it for every transfer */
+void I2C_Device_Init(I2C_Device_t *device, I2C_Bus_t *bus, uint8_t address, uint32_t baudrate)
 {
-	uint8_t reg_value;
-    const uint8_t reg_address = registerAddress;
-	const uint32_t maxRetries = 5;
-	const uint32_t retryDelayUs = 5;
-	const size_t dataToSend_length = sizeof(reg_address);
-	const size_t dataToRead_length = sizeof(reg_value);
-	uint32_t errorCount = 0;
+	device->bus = bus;
+	device->address = address;
+	device->timing.hcnt = 0; /* hcnt = 0 - use the bus timing */
+	if(baudrate != 0)
+	{
+		I2C_ComputeTiming(baudrate, &device->timing);
+	}
+}
 
-	/* Send a request to read a register of the slave device */
-	/* This is done with a write transaction providing the address of the register you want to read */
-    while(!i2c_write_blocking(i2c_default, DS1307_I2C_ADDRESS, &reg_address, dataToSend_length, true))
+/** Hold the controller in reset between transfers (lowest power, e.g. on duty-cycled nodes) - 
+ *  unlike I2C_Bus_Reset()/Reset_I2C0(), which reset and release it. No transfer works until I2C_Bus_Resume().
+ *  The pins stay assigned to I2C - the pull-ups keep the bus idle.
+*/
+void I2C_Bus_Suspend(I2C_Bus_t *bus)
+{
+	const uint32_t resetBits = (i2c_hw_index(bus->instance) == 0) ? RESETS_RESET_I2C0_BITS : RESETS_RESET_I2C1_BITS;
+
+	hw_set_bits(&ResetCtrl_Regs->reset, resetBits);
+	bus->activeTiming = NULL;
+}
+
+/** Release the controller from reset and restore the bus configuration - with the saved bus->timing, so a timing 
+ *  set by I2C_ApplyTiming() or computed at another clk_sys frequency survives the suspend.
+*/
+void I2C_Bus_Resume(I2C_Bus_t *bus)
+{
+	I2C_Bus_Reset(bus);
+	I2C_Configure(bus);
+}
+
+/* Configure the default bus (I2C0). The pins are set up separately by setupPinsI2C0() */
+void I2C_Initialize(uint32_t baudrate) 
+{
+	I2C_DefaultBus.baudrate = baudrate;
+	I2C_ComputeTiming(baudrate, &I2C_DefaultBus.timing);
+	I2C_Configure(&I2C_DefaultBus);
+}
+
+static uint8_t I2C_DecodeAbortSource(uint32_t abortSource)
+{
+	if(abortSource & I2C_IC_TX_ABRT_SOURCE_ABRT_7B_ADDR_NOACK_BITS)
+	{
+		return I2C_ERROR_ADDRESS_NACK;
+	}
+	if(abortSource & I2C_IC_TX_ABRT_SOURCE_ABRT_TXDATA_NOACK_BITS)
+	{
+		return I2C_ERROR_DATA_NACK;
+	}
+	if(abortSource & I2C_IC_TX_ABRT_SOURCE_ARB_LOST_BITS)
 	{
-		printf("I2C write transaction failed. Retrying... "); /* Data not acknowledged by slave (or some other error) */
+		return I2C_ERROR_ARBITRATION_LOST;
+	}
+	return I2C_ERROR_ABORT_OTHER;
+}
+
+/* IC_TAR can only be changed while the controller is disabled - skip it when talking to the same slave again */
+static void I2C_SetTarget(i2c_hw_t *regs, uint8_t slaveAddress)
+{
+	if((regs->tar & 0x3FF) != slaveAddress)
+	{
+		regs->enable = 0;
+		regs->tar = slaveAddress;
+		regs->enable = 1;
+	}
+}
+
+/** Prepare the bus for a transfer to 'device': switch to its speed and address if the previous transfer on the bus 
+ *  was for another device. Used by the blocking transaction layer as well as by the DMA/IRQ transfers.
+*/
+void I2C_Dev_Select(I2C_Device_t *device)
+{
+	I2C_Bus_t *bus = device->bus;
+	const I2C_Timing_t *timing = (device->timing.hcnt != 0) ? &device->timing : &bus->timing;
+
+	if(bus->backend != NULL)
+	{
+		return; /* No controller to program */
+	}
+
+	if(bus->activeTiming != timing)
+	{
+		I2C_Bus_ApplyTiming(bus, timing);
+	}
+	I2C_SetTarget(I2C_Regs(bus), device->address);
+}
 
-		sleep_us(retryDelayUs);
-		errorCount++;
-		if(errorCount > maxRetries)
+/* Wait (bounded) for the STOP condition that ends every transfer, also the aborted ones */
+static bool I2C_WaitForStop(i2c_hw_t *regs, absolute_time_t deadline)
+{
+	while(!(regs->raw_intr_stat & I2C_IC_RAW_INTR_STAT_STOP_DET_BITS))
+	{
+		if(time_reached(deadline))
 		{
-			return MPU6050_REGISTER_I2C_READ_FAIL;
+			return false;
 		}
 	}
-	errorCount = 0;
-	/* Send a read command specifying the number of bytes (1) you want to read (of the register address you specified in prev command) */
-    while(!i2c_read_blocking(i2c_default, DS1307_I2C_ADDRESS, &reg_value, dataToRead_length, false))
-	{
-		printf("I2C read transaction failed. Retrying... "); 
+	(void)regs->clr_stop_det;
+	return true;
+}
 
-		sleep_us(retryDelayUs);
-		errorCount++;
-		if(errorCount > maxRetries)
+/** Free a bus held low by a slave that lost track of the transfer (e.g. MCU reset mid-read): 
+ *  clock SCL up to 9 times until the slave releases SDA, then generate a STOP condition. 
+ *  The pins are driven as open drain via the SIO (output low / input with pull-up for high) at ~100kHz.
+*/
+void I2C_Bus_Recovery(I2C_Bus_t *bus)
+{
+	i2c_hw_t *regs = I2C_Regs(bus);
+	const uint32_t halfPeriodUs = 5;
+	const uint32_t sda = bus->sdaPin;
+	const uint32_t scl = bus->sclPin;
+
+	/* Stop the controller from driving the bus during the recovery */
+	regs->enable = 0;
+
+	gpio_init(sda);
+	gpio_init(scl);
+	gpio_pull_up(sda);
+	gpio_pull_up(scl);
+	gpio_put(sda, 0);
+	gpio_put(scl, 0);
+	gpio_set_dir(sda, GPIO_IN);
+
+	for(uint32_t clock = 0; clock < 9; clock++)
+	{
+		gpio_set_dir(scl, GPIO_OUT); /* SCL low */
+		sleep_us(halfPeriodUs);
+		gpio_set_dir(scl, GPIO_IN);  /* SCL released high */
+		sleep_us(halfPeriodUs);
+		if(gpio_get(sda))
 		{
-			return MPU6050_REGISTER_I2C_READ_FAIL;
+			break; /* Slave released SDA */
 		}
 	}
-	return reg_value;
+
+	/* STOP condition: SDA low -> high while SCL is high */
+	gpio_set_dir(scl, GPIO_OUT);
+	gpio_set_dir(sda, GPIO_OUT);
+	sleep_us(halfPeriodUs);
+	gpio_set_dir(scl, GPIO_IN);
+	sleep_us(halfPeriodUs);
+	gpio_set_dir(sda, GPIO_IN);
+	sleep_us(halfPeriodUs);
+
+	gpio_set_function(sda, GPIO_FUNC_I2C);
+	gpio_set_function(scl, GPIO_FUNC_I2C);
+
+	regs->enable = 1;
 }
 
-uint8_t I2C_Register_Write(uint8_t registerAddress, uint8_t registerValue) 
+/** End of an aborted transfer (TX_ABRT or I2C_Bus_AbortTransfer()) for the DMA/IRQ engines: the controller sends 
+ *  the STOP only after the abort, so STOP_DET latches later - wait for it (bounded by attemptTimeoutBaseUs) and 
+ *  clear TX_ABRT/STOP_DET, so the next transfer doesn't take the stale STOP_DET for its own end.
+ *  Returns false if no STOP was seen (bus held).
+*/
+bool I2C_Bus_CompleteAbort(I2C_Bus_t *bus)
 {
-	size_t length;
-	uint32_t errorCount = 0;
-	const uint32_t maxRetries = 5;
-	const uint32_t retryDelayUs = 5;
+	i2c_hw_t *regs = I2C_Regs(bus);
+	bool stopped = I2C_WaitForStop(regs, make_timeout_time_us(bus->retryPolicy.attemptTimeoutBaseUs));
 
-    uint8_t outputData_Reset[] = {registerAddress, registerValue};
-	length = sizeof(outputData_Reset);
-	while(!i2c_write_blocking(i2c_default, DS1307_I2C_ADDRESS, outputData_Reset, length, false))
+	(void)regs->clr_tx_abrt;
+	(void)regs->clr_stop_det;
+	return stopped;
+}
+
+/** Abort an ongoing transfer (IC_ENABLE.ABORT) - the controller sends a STOP and flushes the TX FIFO. 
+ *  Also used by the DMA/IRQ engines to cancel a transfer (I2C_DMA_Cancel(), I2C_IRQ_Cancel()).
+*/
+void I2C_Bus_AbortTransfer(I2C_Bus_t *bus)
+{
+	i2c_hw_t *regs = I2C_Regs(bus);
+	absolute_time_t deadline = make_timeout_time_us(bus->retryPolicy.attemptTimeoutBaseUs);
+
+	hw_set_bits(&regs->enable, I2C_IC_ENABLE_ABORT_BITS);
+	while((regs->enable & I2C_IC_ENABLE_ABORT_BITS) && !time_reached(deadline))
 	{
-		printf("I2C write transaction failed. Retrying... "); /* Data not acknowledged by slave (or some other error) */
+		tight_loop_contents();
+	}
+	(void)regs->clr_tx_abrt;
+	(void)regs->clr_stop_det;
+}
+
+/** One attempt on the controller: write 'txLength' bytes, then (if rxLength > 0) RESTART and read 'rxLength' bytes, 
+ *  then STOP - bounded by a deadline. Returns an I2C_ERROR_ code. Retries are up to I2C_Dev_Transaction().
+*/
+uint8_t I2C_Bus_TransferAttempt(I2C_Bus_t *bus, const uint8_t *txData, size_t txLength, uint8_t *rxData, size_t rxLength)
+{
+	i2c_hw_t *regs = I2C_Regs(bus);
+	const size_t commandCount = txLength + rxLength;
+	const uint32_t fifoDepth = 16;
+	absolute_time_t deadline = make_timeout_time_us(bus->retryPolicy.attemptTimeoutBaseUs + (bus->retryPolicy.perByteTimeoutUs * commandCount));
+	size_t commandsIssued = 0;
+	size_t bytesReceived = 0;
+
+	(void)regs->clr_tx_abrt;
+	(void)regs->clr_stop_det;
 
-		sleep_us(retryDelayUs);
-		errorCount++;
-		if(errorCount > maxRetries)
+	while((commandsIssued < commandCount) || (bytesReceived < rxLength))
+	{
+		/* Feed the TX FIFO - for reads never have more bytes requested than the RX FIFO can hold */
+		while((commandsIssued < commandCount) && (regs->txflr < fifoDepth))
 		{
-			return MPU6050_REGISTER_I2C_READ_FAIL;
+			uint32_t command;
+
+			if(commandsIssued < txLength)
+			{
+				command = txData[commandsIssued];
+			}
+			else
+			{
+				if((commandsIssued - txLength - bytesReceived) >= fifoDepth)
+				{
+					break;
+				}
+				command = I2C_IC_DATA_CMD_CMD_BITS;
+				if((commandsIssued == txLength) && (txLength > 0))
+				{
+					command |= I2C_IC_DATA_CMD_RESTART_BITS;
+				}
+			}
+			if(commandsIssued == (commandCount - 1))
+			{
+				command |= I2C_IC_DATA_CMD_STOP_BITS;
+			}
+
+			regs->data_cmd = command;
+			commandsIssued++;
 		}
+
+		while((regs->rxflr > 0) && (bytesReceived < rxLength))
+		{
+			rxData[bytesReceived++] = (uint8_t)(regs->data_cmd & I2C_IC_DATA_CMD_DAT_BITS);
+		}
+
+		if(regs->raw_intr_stat & I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS)
+		{
+			bus->lastAbortSource = regs->tx_abrt_source;
+			(void)regs->clr_tx_abrt;
+			(void)I2C_WaitForStop(regs, deadline);
+			return I2C_DecodeAbortSource(bus->lastAbortSource);
+		}
+
+		if(time_reached(deadline))
+		{
+			bus->lastAbortSource = 0;
+			I2C_Bus_AbortTransfer(bus);
+			return I2C_ERROR_TIMEOUT;
+		}
+	}
+
+	if(!I2C_WaitForStop(regs, deadline))
+	{
+		bus->lastAbortSource = 0;
+		I2C_Bus_AbortTransfer(bus);
+		return I2C_ERROR_TIMEOUT;
 	}
 
+	return I2C_ERROR_NONE;
+}
+
+void I2C_BusRecovery()
+{
+	I2C_Bus_Recovery(&I2C_DefaultBus);
+}
+
+/* Default pins of the default bus (I2C0) - for other buses/pins use I2C_Bus_Init() */
+int setupPinsI2C0()
+{
+	/* Configure I2C pins */
+    gpio_set_function(PICO_DEFAULT_I2C_SDA_PIN, GPIO_FUNC_I2C);
+    gpio_set_function(PICO_DEFAULT_I2C_SCL_PIN, GPIO_FUNC_I2C);
+    gpio_pull_up(PICO_DEFAULT_I2C_SDA_PIN);
+    gpio_pull_up(PICO_DEFAULT_I2C_SCL_PIN);
+
+    /* Make the I2C pins available to picotool */
+    bi_decl(bi_2pins_with_func(PICO_DEFAULT_I2C_SDA_PIN, PICO_DEFAULT_I2C_SCL_PIN, GPIO_FUNC_I2C));
+
 	return STATUS_SUCCESS;
 }
@@ -0,0 +1,384 @@
+/**
+ * Interrupt-driven I2C transfers with a request queue - Datasheet chapters 4.3.7 (Operation Modes) and 4.3.11 (Interrupts)
+ * 
+ * How it works:
+ * - Callers push read/write descriptors into a fixed-size ring queue (I2C_IRQ_Submit).
+ * - The ISR feeds the TX FIFO with IC_DATA_CMD commands on TX_EMPTY, drains the RX FIFO on RX_FULL and finishes
+ *   the transfer on STOP_DET (or TX_ABRT on error). Right after that, still inside the ISR, the next queued
+ *   transfer is started - queued operations run back-to-back on the bus without returning to thread context.
+ * - The completion callback of every transfer is called from the ISR.
+ * - After a TX_ABRT (or a cancel) the STOP that follows the abort is waited for (bounded) before the next transfer
+ *   starts, and every transfer clears TX_ABRT/STOP_DET before unmasking - a stale STOP_DET can't end it early.
+ * - Every controller has its own queue, the bus of a transfer is the bus of its device.
+ * - The queues and the start/end of a transfer are guarded by a hardware spin lock, so transfers can be submitted 
+ *   (and cancelled) from both cores, from interrupts and from completion callbacks. The callbacks are called 
+ *   without the lock held.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/address_mapped.h"
+#include "hardware/i2c.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#include "I2C_Driver.h"
+#include "I2C_IRQ.h"
+
+/* Queue and state machine of one controller */
+typedef struct
+{
+	i2c_inst_t *instance;
+	I2C_Transfer_t transferQueue[I2C_IRQ_QUEUE_SIZE];
+	volatile uint32_t queueHead; /* Next free slot - written by Submit */
+	volatile uint32_t queueTail; /* Transfer on the bus - written by the completion */
+	volatile bool transferActive;	/* Engine running - false only with an empty queue */
+	volatile bool transferEnding;	/* The transfer at the tail is being completed (ISR or I2C_IRQ_Cancel()) */
+	volatile bool restartPending;	/* Tail advanced, callback running - the next transfer isn't started yet */
+	size_t commandsIssued;	/* Entries pushed to IC_DATA_CMD (register pointer + data/read commands) */
+	size_t bytesReceived;
+} I2C_IRQ_State_t;
+
+static I2C_IRQ_State_t irqState[I2C_CONTROLLER_COUNT];
+static spin_lock_t *irqLock = NULL; /* Claimed by the first I2C_IRQ_Initialize() */
+
+static I2C_IRQ_State_t *I2C_IRQ_GetState(const I2C_Bus_t *bus)
+{
+	return &irqState[i2c_hw_index(bus->instance)];
+}
+
+static I2C_Transfer_t *I2C_IRQ_CurrentTransfer(I2C_IRQ_State_t *state)
+{
+	return &state->transferQueue[state->queueTail % I2C_IRQ_QUEUE_SIZE];
+}
+
+/* Push as many commands as the FIFOs allow - for reads never request more bytes than the RX FIFO can hold */
+static void I2C_IRQ_FillTxFifo(I2C_IRQ_State_t *state, const I2C_Transfer_t *transfer)
+{
+	i2c_hw_t *regs = i2c_get_hw(state->instance);
+	const size_t commandCount = transfer->length + 1;
+
+	while((state->commandsIssued < commandCount) && (regs->txflr < I2C_IRQ_FIFO_DEPTH))
+	{
+		uint32_t command;
+
+		if(state->commandsIssued == 0)
+		{
+			command = transfer->startRegisterAddress;
+		}
+		else if(transfer->isRead)
+		{
+			if((state->commandsIssued - 1 - state->bytesReceived) >= I2C_IRQ_FIFO_DEPTH)
+			{
+				break;
+			}
+			command = I2C_IC_DATA_CMD_CMD_BITS;
+			if(state->commandsIssued == 1)
+			{
+				command |= I2C_IC_DATA_CMD_RESTART_BITS;
+			}
+		}
+		else
+		{
+			command = transfer->buffer[state->commandsIssued - 1];
+		}
+
+		if(state->commandsIssued == (commandCount - 1))
+		{
+			command |= I2C_IC_DATA_CMD_STOP_BITS;
+		}
+
+		regs->data_cmd = command;
+		state->commandsIssued++;
+	}
+
+	if(state->commandsIssued == commandCount)
+	{
+		/* Everything is queued in the controller, only STOP_DET/TX_ABRT (and RX_FULL for reads) are of interest now */
+		hw_clear_bits(&regs->intr_mask, I2C_IC_INTR_MASK_M_TX_EMPTY_BITS);
+	}
+}
+
+static void I2C_IRQ_DrainRxFifo(I2C_IRQ_State_t *state, const I2C_Transfer_t *transfer)
+{
+	i2c_hw_t *regs = i2c_get_hw(state->instance);
+
+	while((regs->rxflr > 0) && (state->bytesReceived < transfer->length))
+	{
+		transfer->buffer[state->bytesReceived++] = (uint8_t)(regs->data_cmd & I2C_IC_DATA_CMD_DAT_BITS);
+	}
+}
+
+/* Start the transfer at the queue tail (if any). Called with irqLock held */
+static void I2C_IRQ_StartNext(I2C_IRQ_State_t *state)
+{
+	i2c_hw_t *regs = i2c_get_hw(state->instance);
+
+	if(state->queueTail == state->queueHead)
+	{
+		state->transferActive = false;
+		regs->intr_mask = 0;
+		return;
+	}
+
+	const I2C_Transfer_t *transfer = I2C_IRQ_CurrentTransfer(state);
+
+	state->transferActive = true;
+	state->transferEnding = false;
+	state->commandsIssued = 0;
+	state->bytesReceived = 0;
+
+	/* Speed/address of the device - skipped when talking to the same slave again */
+	I2C_Dev_Select(transfer->device);
+
+	/* Nothing of an earlier transfer (this engine, DMA, blocking layer) may end or feed this one */
+	while(regs->rxflr > 0)
+	{
+		(void)regs->data_cmd;
+	}
+	(void)regs->clr_tx_abrt;
+	(void)regs->clr_stop_det;
+	regs->intr_mask = I2C_IC_INTR_MASK_M_TX_EMPTY_BITS | I2C_IC_INTR_MASK_M_STOP_DET_BITS | I2C_IC_INTR_MASK_M_TX_ABRT_BITS |
+					  (transfer->isRead ? I2C_IC_INTR_MASK_M_RX_FULL_BITS : 0);
+	I2C_IRQ_FillTxFifo(state, transfer);
+}
+
+/* Take over the completion of the transfer on the bus - only one of the ISR and I2C_IRQ_Cancel() wins */
+static bool I2C_IRQ_BeginFinish(I2C_IRQ_State_t *state)
+{
+	uint32_t lockState = spin_lock_blocking(irqLock);
+	bool owner = state->transferActive && !state->transferEnding && !state->restartPending;
+
+	if(owner)
+	{
+		state->transferEnding = true;
+	}
+	spin_unlock(irqLock, lockState);
+	return owner;
+}
+
+/* Called by the owner of the completion (see I2C_IRQ_BeginFinish()) - callback without the lock, then the next one */
+static void I2C_IRQ_FinishCurrent(I2C_IRQ_State_t *state, uint8_t status)
+{
+	const I2C_Transfer_t *transfer = I2C_IRQ_CurrentTransfer(state);
+	I2C_TransferCallback_t callback = transfer->callback;
+	void *context = transfer->context;
+
+	i2c_get_hw(state->instance)->intr_mask = 0;
+
+	uint32_t lockState = spin_lock_blocking(irqLock);
+	state->queueTail++;
+	state->transferEnding = false;
+	state->restartPending = true; /* Submit calls (e.g. from the callback) only queue, the transfer is started below */
+	spin_unlock(irqLock, lockState);
+
+	if(callback != NULL)
+	{
+		callback(status, context);
+	}
+
+	lockState = spin_lock_blocking(irqLock);
+	state->restartPending = false;
+	I2C_IRQ_StartNext(state);
+	spin_unlock(irqLock, lockState);
+}
+
+static void I2C_IRQ_HandleInterrupt(I2C_IRQ_State_t *state)
+{
+	if(!state->transferActive)
+	{
+		return; /* Not our transfer (the I2C IRQ is shared) */
+	}
+
+	i2c_hw_t *regs = i2c_get_hw(state->instance);
+	if(state->transferEnding || state->restartPending)
+	{
+		regs->intr_mask = 0; /* Completion in progress (I2C_IRQ_Cancel() preempted) - don't keep interrupting it */
+		return;
+	}
+
+	const I2C_Transfer_t *transfer = I2C_IRQ_CurrentTransfer(state);
+	uint32_t interruptStatus = regs->intr_stat;
+
+	if(interruptStatus & I2C_IC_INTR_STAT_R_TX_ABRT_BITS)
+	{
+		if(!I2C_IRQ_BeginFinish(state))
+		{
+			regs->intr_mask = 0;
+			return;
+		}
+		regs->intr_mask = 0;
+		(void)regs->clr_tx_abrt;
+		/* The STOP follows the abort - wait for it before the next transfer is started */
+		(void)I2C_Bus_CompleteAbort(transfer->device->bus);
+		I2C_IRQ_FinishCurrent(state, MPU6050_REGISTER_I2C_READ_FAIL);
+		return;
+	}
+
+	if(interruptStatus & I2C_IC_INTR_STAT_R_RX_FULL_BITS)
+	{
+		I2C_IRQ_DrainRxFifo(state, transfer);
+	}
+
+	if(interruptStatus & I2C_IC_INTR_STAT_R_TX_EMPTY_BITS)
+	{
+		I2C_IRQ_FillTxFifo(state, transfer);
+	}
+
+	if(interruptStatus & I2C_IC_INTR_STAT_R_STOP_DET_BITS)
+	{
+		if(!I2C_IRQ_BeginFinish(state))
+		{
+			regs->intr_mask = 0;
+			return;
+		}
+		(void)regs->clr_stop_det;
+		if(transfer->isRead)
+		{
+			I2C_IRQ_DrainRxFifo(state, transfer);
+		}
+		I2C_IRQ_FinishCurrent(state, ((!transfer->isRead) || (state->bytesReceived == transfer->length)) ? STATUS_SUCCESS : STAUS_FAILURE);
+	}
+}
+
+static void I2C0_IRQ_Handler()
+{
+	I2C_IRQ_HandleInterrupt(&irqState[0]);
+}
+
+static void I2C1_IRQ_Handler()
+{
+	I2C_IRQ_HandleInterrupt(&irqState[1]);
+}
+
+/* Must be called once per bus after the bus is initialized */
+uint8_t I2C_IRQ_Initialize(I2C_Bus_t *bus)
+{
+	I2C_IRQ_State_t *state = I2C_IRQ_GetState(bus);
+	i2c_hw_t *regs = i2c_get_hw(bus->instance);
+	const uint32_t index = i2c_hw_index(bus->instance);
+
+	if(irqLock == NULL)
+	{
+		irqLock = spin_lock_init((uint)spin_lock_claim_unused(true));
+	}
+
+	state->instance = bus->instance;
+	state->queueHead = 0;
+	state->queueTail = 0;
+	state->transferActive = false;
+	state->transferEnding = false;
+	state->restartPending = false;
+
+	regs->intr_mask = 0;
+	regs->tx_tl = I2C_IRQ_TX_FIFO_THRESHOLD;
+	regs->rx_tl = I2C_IRQ_RX_FIFO_THRESHOLD;
+
+	irq_add_shared_handler(I2C0_IRQ + index, (index == 0) ? I2C0_IRQ_Handler : I2C1_IRQ_Handler, 
+						   PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+	irq_set_enabled(I2C0_IRQ + index, true);
+
+	return STATUS_SUCCESS;
+}
+
+/* Queue a transfer on the bus of its device - returns STATUS_BUSY if the queue is full */
+uint8_t I2C_IRQ_Submit(const I2C_Transfer_t *transfer)
+{
+	if((transfer->length == 0) || (transfer->buffer == NULL) || (transfer->device == NULL) || (irqLock == NULL))
+	{
+		return STAUS_FAILURE;
+	}
+
+	I2C_IRQ_State_t *state = I2C_IRQ_GetState(transfer->device->bus);
+	uint32_t lockState = spin_lock_blocking(irqLock);
+
+	if((state->queueHead - state->queueTail) >= I2C_IRQ_QUEUE_SIZE)
+	{
+		spin_unlock(irqLock, lockState);
+		return STATUS_BUSY;
+	}
+
+	state->transferQueue[state->queueHead % I2C_IRQ_QUEUE_SIZE] = *transfer;
+	state->queueHead++;
+
+	/* Bus idle - kick off the state machine, afterwards the ISR keeps it going. Checked under the lock, so a 
+	 * completion on the other core can't find the queue empty and stop the engine after this transfer was added */
+	if(!state->transferActive)
+	{
+		I2C_IRQ_StartNext(state);
+	}
+
+	spin_unlock(irqLock, lockState);
+
+	return STATUS_SUCCESS;
+}
+
+/* Number of transfers queued or on the bus */
+uint32_t I2C_IRQ_PendingCount(const I2C_Bus_t *bus)
+{
+	const I2C_IRQ_State_t *state = I2C_IRQ_GetState(bus);
+
+	return state->queueHead - state->queueTail;
+}
+
+/** Remove the transfer submitted with 'context' (e.g. its caller's deadline passed, SCL held low): aborted on the 
+ *  controller if it is on the bus, taken out of the queue otherwise (it never runs). It completes with 
+ *  MPU6050_REGISTER_I2C_READ_FAIL - its callback is called from here, so every transfer still gets exactly one 
+ *  callback. The transfers behind it continue. STAUS_FAILURE if no such transfer is pending (already completed).
+*/
+uint8_t I2C_IRQ_Cancel(I2C_Bus_t *bus, void *context)
+{
+	I2C_IRQ_State_t *state = I2C_IRQ_GetState(bus);
+
+	if(irqLock == NULL)
+	{
+		return STAUS_FAILURE;
+	}
+
+	uint32_t lockState = spin_lock_blocking(irqLock);
+	uint32_t index = state->queueTail;
+
+	while((index != state->queueHead) && (state->transferQueue[index % I2C_IRQ_QUEUE_SIZE].context != context))
+	{
+		index++;
+	}
+	if(index == state->queueHead)
+	{
+		spin_unlock(irqLock, lockState);
+		return STAUS_FAILURE;
+	}
+
+	if((index == state->queueTail) && state->transferActive && !state->restartPending)
+	{
+		/* On the bus */
+		if(state->transferEnding)
+		{
+			spin_unlock(irqLock, lockState);
+			return STAUS_FAILURE; /* Completing right now - its callback comes from there */
+		}
+		state->transferEnding = true;
+		spin_unlock(irqLock, lockState);
+
+		i2c_get_hw(state->instance)->intr_mask = 0;
+		I2C_Bus_AbortTransfer(bus);
+		(void)I2C_Bus_CompleteAbort(bus);
+		I2C_IRQ_FinishCurrent(state, MPU6050_REGISTER_I2C_READ_FAIL);
+		return STATUS_SUCCESS;
+	}
+
+	I2C_Transfer_t cancelled = state->transferQueue[index % I2C_IRQ_QUEUE_SIZE];
+
+	/* Only queued - close the gap, it never runs */
+	for(; (index + 1) != state->queueHead; index++)
+	{
+		state->transferQueue[index % I2C_IRQ_QUEUE_SIZE] = state->transferQueue[(index + 1) % I2C_IRQ_QUEUE_SIZE];
+	}
+	state->queueHead--;
+	spin_unlock(irqLock, lockState);
+
+	if(cancelled.callback != NULL)
+	{
+		cancelled.callback(MPU6050_REGISTER_I2C_READ_FAIL, cancelled.context);
+	}
+	return STATUS_SUCCESS;
+}
@@ -0,0 +1,228 @@
+/**
+ * Shared-bus transaction scheduler with per-transfer priorities, on top of the interrupt-driven engine (I2C_IRQ.c).
+ * 
+ * How it works:
+ * - Every bus has one queue per priority level. Device drivers submit transfer descriptors with a priority.
+ * - Only one transfer per bus is handed to the IRQ engine at a time. When it completes, the next one is picked 
+ *   from the highest priority non-empty queue - straight from the completion interrupt, so transfers still run 
+ *   back-to-back on the bus.
+ * - Non-critical reads are split into chunks of I2C_SCHED_MAX_CHUNK bytes (the register pointer of the chunk
+ *   is advanced accordingly - register auto-increment). A critical request therefore waits at most for one short
+ *   chunk, never for a whole 56 byte NVRAM burst read.
+ * - Writes are never split: a multi-byte write (timekeeper block, journal slot) must reach the DS1307 as one 
+ *   transaction - between two chunks the RTC could tick or another client could write the same registers.
+ *   A long write delays a critical request by its whole length (~1.3ms for 56 bytes at 400kHz).
+ *   Split reads aren't one snapshot either - the timekeeper block (7 bytes) fits into a single chunk.
+ * - Inside every chunk the register pointer write and the read are joined by a repeated START. Consecutive 
+ *   transfers are not batched into one repeated-START sequence: IC_TAR only changes with the controller disabled,
+ *   so a repeated START can't switch devices, and for the same device it would only save one STOP/START (a few us
+ *   at 400kHz) while losing the per-transfer status and callback. Queued transfers already follow each other 
+ *   straight from the completion interrupt.
+ * - The queues are guarded by a hardware spin lock (schedLock), the IRQ engine queue by its own (taken inside, 
+ *   never the other way round), so transfers can be submitted and cancelled from both cores and from interrupts.
+ *   Completion callbacks are called without the lock held (they may submit again).
+*/
+
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+#include "I2C_Driver.h"
+#include "I2C_IRQ.h"
+#include "I2C_Scheduler.h"
+
+typedef struct
+{
+	I2C_Transfer_t transfer;
+	size_t bytesDone;
+} I2C_SchedJob_t;
+
+typedef struct
+{
+	I2C_SchedJob_t jobs[I2C_SCHED_QUEUE_SIZE];
+	uint32_t head;
+	uint32_t tail;
+} I2C_SchedQueue_t;
+
+typedef struct
+{
+	I2C_SchedQueue_t queues[I2C_SCHED_PRIORITY_LEVELS];
+	I2C_SchedJob_t *activeJob;
+	uint8_t activePriority;
+} I2C_SchedState_t;
+
+static I2C_SchedState_t schedState[I2C_CONTROLLER_COUNT];
+static spin_lock_t *schedLock = NULL; /* Claimed by the first I2C_Scheduler_Init() */
+
+static I2C_SchedState_t *I2C_Scheduler_GetState(const I2C_Bus_t *bus)
+{
+	return &schedState[i2c_hw_index(bus->instance)];
+}
+
+static void I2C_Scheduler_ChunkComplete(uint8_t status, void *context);
+
+/* Length of the next chunk of the active job - only non-critical reads are split */
+static size_t I2C_Scheduler_ChunkLength(const I2C_SchedState_t *state)
+{
+	const I2C_SchedJob_t *job = state->activeJob;
+	size_t remaining = job->transfer.length - job->bytesDone;
+
+	if((state->activePriority != I2C_SCHED_PRIORITY_CRITICAL) && job->transfer.isRead && (remaining > I2C_SCHED_MAX_CHUNK))
+	{
+		return I2C_SCHED_MAX_CHUNK;
+	}
+	return remaining;
+}
+
+/** Hand the next chunk to the IRQ engine - called with the scheduler lock held.
+ *  Returns false if the IRQ engine refused it (queue full - someone else uses it directly): the caller completes the 
+ *  active job with a failure once the lock is released, so the scheduler doesn't stall.
+*/
+static bool I2C_Scheduler_Dispatch(I2C_SchedState_t *state)
+{
+	if(state->activeJob == NULL)
+	{
+		for(uint8_t priority = 0; priority < I2C_SCHED_PRIORITY_LEVELS; priority++)
+		{
+			I2C_SchedQueue_t *queue = &state->queues[priority];
+			if(queue->head != queue->tail)
+			{
+				state->activeJob = &queue->jobs[queue->tail % I2C_SCHED_QUEUE_SIZE];
+				state->activePriority = priority;
+				break;
+			}
+		}
+		if(state->activeJob == NULL)
+		{
+			return true; /* Nothing to do */
+		}
+	}
+
+	const I2C_SchedJob_t *job = state->activeJob;
+	I2C_Transfer_t chunk = job->transfer;
+	chunk.startRegisterAddress = (uint8_t)(job->transfer.startRegisterAddress + job->bytesDone);
+	chunk.buffer = job->transfer.buffer + job->bytesDone;
+	chunk.length = I2C_Scheduler_ChunkLength(state);
+	chunk.callback = I2C_Scheduler_ChunkComplete;
+	chunk.context = state;
+
+	return (I2C_IRQ_Submit(&chunk) == STATUS_SUCCESS);
+}
+
+static void I2C_Scheduler_ChunkComplete(uint8_t status, void *context)
+{
+	I2C_SchedState_t *state = (I2C_SchedState_t *)context;
+	I2C_TransferCallback_t callback = NULL;
+	void *userContext = NULL;
+	uint32_t lockState = spin_lock_blocking(schedLock);
+	I2C_SchedJob_t *job = state->activeJob;
+
+	job->bytesDone += I2C_Scheduler_ChunkLength(state);
+
+	if((status != STATUS_SUCCESS) || (job->bytesDone >= job->transfer.length))
+	{
+		/* Job finished - pop it, its callback is called once the lock is released */
+		callback = job->transfer.callback;
+		userContext = job->transfer.context;
+
+		state->queues[state->activePriority].tail++;
+		state->activeJob = NULL;
+	}
+	else
+	{
+		/* More chunks to go - let a more important transfer in first if there is one */
+		for(uint8_t priority = 0; priority < state->activePriority; priority++)
+		{
+			if(state->queues[priority].head != state->queues[priority].tail)
+			{
+				state->activeJob = NULL; /* Stays at its queue tail with its progress, resumed later */
+				break;
+			}
+		}
+	}
+
+	bool dispatched = I2C_Scheduler_Dispatch(state);
+	spin_unlock(schedLock, lockState);
+
+	if(callback != NULL)
+	{
+		callback(status, userContext);
+	}
+	if(!dispatched)
+	{
+		I2C_Scheduler_ChunkComplete(STAUS_FAILURE, state);
+	}
+}
+
+/* Must be called once per bus after the bus is initialized - initializes the IRQ engine of the bus too */
+uint8_t I2C_Scheduler_Init(I2C_Bus_t *bus)
+{
+	I2C_SchedState_t *state = I2C_Scheduler_GetState(bus);
+
+	if(schedLock == NULL)
+	{
+		schedLock = spin_lock_init((uint)spin_lock_claim_unused(true));
+	}
+
+	uint32_t lockState = spin_lock_blocking(schedLock);
+	for(uint8_t priority = 0; priority < I2C_SCHED_PRIORITY_LEVELS; priority++)
+	{
+		state->queues[priority].head = 0;
+		state->queues[priority].tail = 0;
+	}
+	state->activeJob = NULL;
+	spin_unlock(schedLock, lockState);
+
+	return I2C_IRQ_Initialize(bus);
+}
+
+/* Queue a transfer with the given priority (from any core or interrupt) - returns STATUS_BUSY if the queue of that priority is full */
+uint8_t I2C_Scheduler_Submit(const I2C_Transfer_t *transfer, uint8_t priority)
+{
+	if((priority >= I2C_SCHED_PRIORITY_LEVELS) || (transfer->device == NULL) || (transfer->length == 0) || (schedLock == NULL))
+	{
+		return STAUS_FAILURE;
+	}
+
+	I2C_SchedState_t *state = I2C_Scheduler_GetState(transfer->device->bus);
+	I2C_SchedQueue_t *queue = &state->queues[priority];
+	bool dispatched = true;
+	uint32_t lockState = spin_lock_blocking(schedLock);
+
+	if((queue->head - queue->tail) >= I2C_SCHED_QUEUE_SIZE)
+	{
+		spin_unlock(schedLock, lockState);
+		return STATUS_BUSY;
+	}
+
+	I2C_SchedJob_t *job = &queue->jobs[queue->head % I2C_SCHED_QUEUE_SIZE];
+	job->transfer = *transfer;
+	job->bytesDone = 0;
+	queue->head++;
+
+	if(state->activeJob == NULL)
+	{
+		dispatched = I2C_Scheduler_Dispatch(state);
+	}
+
+	spin_unlock(schedLock, lockState);
+
+	if(!dispatched)
+	{
+		I2C_Scheduler_ChunkComplete(STAUS_FAILURE, state);
+	}
+
+	return STATUS_SUCCESS;
+}
+
+/* Number of transfers waiting or in progress on the bus */
+uint32_t I2C_Scheduler_PendingCount(const I2C_Bus_t *bus)
+{
+	const I2C_SchedState_t *state = I2C_Scheduler_GetState(bus);
+	uint32_t pending = 0;
+
+	for(uint8_t priority = 0; priority < I2C_SCHED_PRIORITY_LEVELS; priority++)
+	{
+		pending += state->queues[priority].head - state->queues[priority].tail;
+	}
+
+	return pending;
+}
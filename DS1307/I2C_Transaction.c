@@ -0,0 +1,269 @@
+/**
+ * Central transaction layer - every blocking transfer of the driver goes through I2C_Dev_Transaction().
+ * 
+ * - Each attempt drives IC_DATA_CMD directly and has a deadline (base + per byte), so a hung bus or a missing 
+ *   device can't stall the core. The SDK blocking calls used before had no timeout and hid the abort reason.
+ * - When the controller aborts, IC_TX_ABRT_SOURCE is decoded (address NACK, data NACK, arbitration lost...) 
+ *   and kept for I2C_GetLastError().
+ * - Failed attempts are retried with exponential backoff, bounded by maxRetries and by the total time budget.
+ * - A timeout (SCL/SDA held low by a slave stuck mid-byte) triggers the bus recovery sequence: 9 SCL clocks 
+ *   followed by a STOP condition (I2C specification UM10204 chapter 3.1.16).
+ * The attempts themselves (I2C_Bus_TransferAttempt()) and the recovery are the controller part in I2C_Driver.c. 
+ * This file only needs DS1307_HAL.h, so it also builds on the host, where the buses run on a backend 
+ * (I2C_Bus_SetBackend()) - see test/.
+*/
+
+#include <string.h>
+#include "DS1307_HAL.h"
+#include "DS1307.h"
+#include "I2C_Driver.h"
+#include "DS1307_Log.h"
+
+/** Every controller (I2C0/I2C1) is described by an I2C_Bus_t and every slave on it by an I2C_Device_t - all state
+ *  (timing, retry policy, last error) lives in these structures, so both controllers can be used in parallel.
+ *  The original API (I2C_Initialize, I2C_Register_Read, ...) works on the default bus - I2C0 on the default pins - 
+ *  and the default device - the DS1307 on that bus.
+*/
+I2C_Bus_t I2C_DefaultBus = I2C_BUS_DEFAULT_INITIALIZER;
+I2C_Device_t I2C_DefaultDevice = { .bus = &I2C_DefaultBus, .address = DS1307_I2C_ADDRESS, .timing = { 0 } };
+
+void I2C_Bus_SetRetryPolicy(I2C_Bus_t *bus, const I2C_RetryPolicy_t *policy)
+{
+	bus->retryPolicy = *policy;
+}
+
+void I2C_SetRetryPolicy(const I2C_RetryPolicy_t *policy)
+{
+	I2C_Bus_SetRetryPolicy(&I2C_DefaultBus, policy);
+}
+
+/* Detailed cause of the last failed transaction on the bus (I2C_ERROR_*), optionally with the raw IC_TX_ABRT_SOURCE */
+uint8_t I2C_Bus_GetLastError(const I2C_Bus_t *bus, uint32_t *abortSource)
+{
+	if(abortSource != NULL)
+	{
+		*abortSource = bus->lastAbortSource;
+	}
+	return bus->lastError;
+}
+
+uint8_t I2C_GetLastError(uint32_t *abortSource)
+{
+	return I2C_Bus_GetLastError(&I2C_DefaultBus, abortSource);
+}
+
+#if DS1307_I2C_STATS
+#define I2C_STATS_COUNT_ERROR(bus, error) ((bus)->stats.errors[(error) < I2C_STATS_ERROR_CODES ? (error) : I2C_ERROR_ABORT_OTHER]++)
+
+static void I2C_Stats_Record(I2C_Stats_t *stats, bool success, uint32_t retries, size_t txLength, size_t rxLength, uint32_t latencyUs)
+{
+	uint32_t bin = 0;
+
+	stats->transactions++;
+	stats->retries += retries;
+	if(success)
+	{
+		stats->bytesWritten += txLength;
+		stats->bytesRead += rxLength;
+	}
+	else
+	{
+		stats->failedTransactions++;
+	}
+
+	if((stats->transactions == 1) || (latencyUs < stats->latencyMinUs))
+	{
+		stats->latencyMinUs = latencyUs;
+	}
+	if(latencyUs > stats->latencyMaxUs)
+	{
+		stats->latencyMaxUs = latencyUs;
+	}
+	stats->latencyTotalUs += latencyUs;
+
+	/* Bin n holds [2^(n+5), 2^(n+6)) us, bin 0 everything below 64us */
+	latencyUs >>= I2C_STATS_HISTOGRAM_FIRST_US_LOG2;
+	if(latencyUs != 0)
+	{
+		bin = 32u - (uint32_t)__builtin_clz(latencyUs);
+		bin = (bin >= I2C_STATS_HISTOGRAM_BINS) ? (I2C_STATS_HISTOGRAM_BINS - 1) : bin;
+	}
+	stats->latencyHistogram[bin]++;
+}
+#else
+#define I2C_STATS_COUNT_ERROR(bus, error) ((void)0)
+#endif
+
+/** Blocking transfer with bounded retries - write txData, then read rxLength bytes with a repeated START.
+ *  Switches the bus to the speed of the device first if it differs from the current one.
+ *  Returns STATUS_SUCCESS or MPU6050_REGISTER_I2C_READ_FAIL (detailed cause - I2C_Bus_GetLastError()). 
+*/
+uint8_t I2C_Dev_Transaction(I2C_Device_t *device, const uint8_t *txData, size_t txLength, uint8_t *rxData, size_t rxLength)
+{
+	I2C_Bus_t *bus = device->bus;
+	const I2C_RetryPolicy_t *policy = &bus->retryPolicy;
+	absolute_time_t budgetDeadline = make_timeout_time_us(policy->totalBudgetUs);
+	uint32_t backoffUs = policy->initialBackoffUs;
+	uint32_t attempt;
+#if DS1307_I2C_STATS
+	uint32_t startUs = time_us_32();
+#endif
+
+	if((txLength + rxLength) == 0)
+	{
+		return STAUS_FAILURE;
+	}
+
+	I2C_Dev_Select(device);
+
+	for(attempt = 0; attempt <= policy->maxRetries; attempt++)
+	{
+		if(bus->backend != NULL)
+		{
+			bus->lastAbortSource = 0;
+			bus->lastError = bus->backend(bus->backendContext, device->address, txData, txLength, rxData, rxLength);
+		}
+		else
+		{
+			bus->lastError = I2C_Bus_TransferAttempt(bus, txData, txLength, rxData, rxLength);
+		}
+		if(bus->lastError == I2C_ERROR_NONE)
+		{
+			break;
+		}
+		I2C_STATS_COUNT_ERROR(bus, bus->lastError);
+
+		LOG_DEBUG("I2C transaction failed (error %u, abort source 0x%x). Retrying... \n", bus->lastError, bus->lastAbortSource);
+		if((bus->lastError == I2C_ERROR_TIMEOUT) && (bus->backend == NULL))
+		{
+			I2C_Bus_Recovery(bus);
+		}
+
+		if((attempt == policy->maxRetries) || 
+		   (absolute_time_diff_us(get_absolute_time(), budgetDeadline) <= (int64_t)backoffUs))
+		{
+			break;
+		}
+		sleep_us(backoffUs);
+		backoffUs = ((backoffUs * 2) > policy->maxBackoffUs) ? policy->maxBackoffUs : (backoffUs * 2);
+	}
+
+#if DS1307_I2C_STATS
+	I2C_Stats_Record(&bus->stats, bus->lastError == I2C_ERROR_NONE, attempt, txLength, rxLength, time_us_32() - startUs);
+#endif
+
+	if(bus->lastError == I2C_ERROR_NONE)
+	{
+		return STATUS_SUCCESS;
+	}
+
+	LOG_WARN("I2C transaction to 0x%x failed (error %u) \n", device->address, bus->lastError);
+	return MPU6050_REGISTER_I2C_READ_FAIL;
+}
+
+/** Route the blocking transactions of 'bus' (I2C_Dev_Transaction() and everything built on it) through 'backend' 
+ *  instead of the controller - e.g. to DS1307_Mock_Transfer() to run the driver without the RTC. 
+ *  Retries and error reporting still apply. The DMA/IRQ engines always drive the controller.
+ *  backend = NULL - back to the controller.
+*/
+void I2C_Bus_SetBackend(I2C_Bus_t *bus, I2C_BackendTransfer_t backend, void *context)
+{
+	bus->backendContext = context;
+	bus->backend = backend;
+	bus->activeTiming = NULL; /* Reprogram the controller on the next hardware transfer */
+}
+
+/* Snapshot of the transaction statistics (all zero when built without DS1307_I2C_STATS) */
+void I2C_Bus_GetStats(const I2C_Bus_t *bus, I2C_Stats_t *stats)
+{
+#if DS1307_I2C_STATS
+	*stats = bus->stats;
+#else
+	(void)bus;
+	memset(stats, 0, sizeof(*stats));
+#endif
+}
+
+void I2C_Bus_ResetStats(I2C_Bus_t *bus)
+{
+#if DS1307_I2C_STATS
+	memset(&bus->stats, 0, sizeof(bus->stats));
+#else
+	(void)bus;
+#endif
+}
+
+/* Transaction with any slave on the default bus (at the bus speed) */
+uint8_t I2C_Transaction(uint8_t slaveAddress, const uint8_t *txData, size_t txLength, uint8_t *rxData, size_t rxLength)
+{
+	I2C_Device_t device = { .bus = &I2C_DefaultBus, .address = slaveAddress, .timing = { 0 } };
+
+	return I2C_Dev_Transaction(&device, txData, txLength, rxData, rxLength);
+}
+
+uint8_t I2C_Dev_Register_Read(I2C_Device_t *device, uint8_t registerAddress) 
+{
+	uint8_t reg_value;
+
+	/* Write the address of the register, then read it back with a repeated START */
+	if(I2C_Dev_Transaction(device, &registerAddress, sizeof(registerAddress), &reg_value, sizeof(reg_value)) != STATUS_SUCCESS)
+	{
+		return MPU6050_REGISTER_I2C_READ_FAIL;
+	}
+	return reg_value;
+}
+
+uint8_t I2C_Dev_Register_Write(I2C_Device_t *device, uint8_t registerAddress, uint8_t registerValue) 
+{
+    const uint8_t outputData[] = {registerAddress, registerValue};
+
+	return I2C_Dev_Transaction(device, outputData, sizeof(outputData), NULL, 0);
+}
+
+/** Read 'length' consecutive registers starting at 'startRegisterAddress' in a single transaction.
+ *  The DS1307 auto-increments its register pointer after each byte read, so one address write
+ *  followed by one multi-byte read returns a consistent snapshot of the whole block. 
+*/
+uint8_t I2C_Dev_Burst_Read(I2C_Device_t *device, uint8_t startRegisterAddress, uint8_t *buffer, size_t length) 
+{
+	return I2C_Dev_Transaction(device, &startRegisterAddress, sizeof(startRegisterAddress), buffer, length);
+}
+
+/** Write 'length' consecutive registers starting at 'startRegisterAddress' in a single transaction.
+ *  The register pointer and all data bytes are sent back-to-back, the DS1307 auto-increments its
+ *  register pointer after each byte written. 
+*/
+uint8_t I2C_Dev_Burst_Write(I2C_Device_t *device, uint8_t startRegisterAddress, const uint8_t *data, size_t length) 
+{
+	uint8_t outputData[I2C_BURST_MAX_LENGTH + 1];
+
+	if(length > I2C_BURST_MAX_LENGTH)
+	{
+		return STAUS_FAILURE;
+	}
+
+	outputData[0] = startRegisterAddress;
+	memcpy(&outputData[1], data, length);
+
+	return I2C_Dev_Transaction(device, outputData, length + 1, NULL, 0);
+}
+
+uint8_t I2C_Register_Read(uint8_t registerAddress) 
+{
+	return I2C_Dev_Register_Read(&I2C_DefaultDevice, registerAddress);
+}
+
+uint8_t I2C_Register_Write(uint8_t registerAddress, uint8_t registerValue) 
+{
+	return I2C_Dev_Register_Write(&I2C_DefaultDevice, registerAddress, registerValue);
+}
+
+uint8_t I2C_Burst_Read(uint8_t startRegisterAddress, uint8_t *buffer, size_t length) 
+{
+	return I2C_Dev_Burst_Read(&I2C_DefaultDevice, startRegisterAddress, buffer, length);
+}
+
+uint8_t I2C_Burst_Write(uint8_t startRegisterAddress, const uint8_t *data, size_t length) 
+{
+	return I2C_Dev_Burst_Write(&I2C_DefaultDevice, startRegisterAddress, data, length);
+}
@@ -0,0 +1,186 @@
+/**
+ * On-device benchmark of the DS1307 library - times every RTC/NVRAM access path at every bus speed and 
+ * prints the results over USB (stdio) as CSV, one line per measurement:
+ * 
+ *   BENCH,<name>,<baudrate>,<iterations>,<failures>,<min_us>,<avg_us>,<max_us>
+ * 
+ * Lines starting with '#' are comments, "BENCH,END" marks the end of one run (repeated every few seconds).
+ * Note: the DS1307 is specified for 100kHz only - the 400kHz and 1MHz runs show what the bus and the driver 
+ * cost at those speeds, failures there are expected with modules that don't keep up.
+*/
+
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "DS1307.h"
+#include "DS1307_NVRAMCache.h"
+#include "I2C_Driver.h"
+#include "I2C_DMA.h"
+#include "I2C_IRQ.h"
+
+#define BENCH_ITERATIONS			100
+#define BENCH_ASYNC_TIMEOUT_US		50000
+#define BENCH_NVRAM_TEST_OFFSET		48 /* Last 8 bytes of the NVRAM - keep application data below */
+#define BENCH_NVRAM_TEST_LENGTH		8
+
+typedef uint8_t (*BenchFunction_t)(void);
+
+static const uint32_t benchBaudrates[] = {I2C_STANDARD_MODE, I2C_FAST_MODE, I2C_FAST_MODE_PLUS};
+
+static uint8_t timekeeperRegs_au8[DS1307_TIMEKEEPER_REGS_LENGTH];
+static uint8_t nvramPattern_au8[BENCH_NVRAM_TEST_LENGTH];
+static volatile bool asyncDone;
+static volatile uint8_t asyncStatus;
+
+static void Bench_Run(const char *name, uint32_t baudrate, BenchFunction_t function)
+{
+	uint32_t minUs = UINT32_MAX;
+	uint32_t maxUs = 0;
+	uint64_t totalUs = 0;
+	uint32_t failures = 0;
+
+	for(uint32_t i = 0; i < BENCH_ITERATIONS; i++)
+	{
+		uint32_t startUs = time_us_32();
+		uint8_t status = function();
+		uint32_t elapsedUs = time_us_32() - startUs;
+
+		if(status != STATUS_SUCCESS)
+		{
+			failures++;
+		}
+		minUs = (elapsedUs < minUs) ? elapsedUs : minUs;
+		maxUs = (elapsedUs > maxUs) ? elapsedUs : maxUs;
+		totalUs += elapsedUs;
+	}
+
+	printf("BENCH,%s,%lu,%u,%lu,%lu,%lu,%lu\n", name, (unsigned long)baudrate, BENCH_ITERATIONS, (unsigned long)failures,
+		   (unsigned long)minUs, (unsigned long)(totalUs / BENCH_ITERATIONS), (unsigned long)maxUs);
+}
+
+/* Timekeeper block register by register - the old way of reading the time */
+static uint8_t Bench_SingleRegisterReads(void)
+{
+	for(uint8_t reg = 0; reg < DS1307_TIMEKEEPER_REGS_LENGTH; reg++)
+	{
+		timekeeperRegs_au8[reg] = I2C_Register_Read(reg);
+		if(I2C_GetLastError(NULL) != I2C_ERROR_NONE)
+		{
+			return STAUS_FAILURE;
+		}
+	}
+	return STATUS_SUCCESS;
+}
+
+static uint8_t Bench_BurstRead(void)
+{
+	return I2C_Burst_Read(DS1307_REG_SECONDS, timekeeperRegs_au8, sizeof(timekeeperRegs_au8));
+}
+
+static uint8_t Bench_ReadDateTime(void)
+{
+	DS1307_DateTime_t dateTime;
+	return DS1307_ReadDateTime(&dateTime);
+}
+
+static void Bench_AsyncCallback(uint8_t status, void *context)
+{
+	(void)context;
+	asyncStatus = status;
+	asyncDone = true;
+}
+
+/* Wait for the completion callback - the time includes the whole transfer, not only the CPU time of the submit */
+static uint8_t Bench_WaitAsync(uint8_t submitStatus)
+{
+	absolute_time_t deadline = make_timeout_time_us(BENCH_ASYNC_TIMEOUT_US);
+
+	if(submitStatus != STATUS_SUCCESS)
+	{
+		return submitStatus;
+	}
+	while(!asyncDone)
+	{
+		if(absolute_time_diff_us(get_absolute_time(), deadline) <= 0)
+		{
+			return STAUS_FAILURE;
+		}
+		tight_loop_contents();
+	}
+	return asyncStatus;
+}
+
+static uint8_t Bench_DMABurstRead(void)
+{
+	asyncDone = false;
+	return Bench_WaitAsync(I2C_DMA_Read_Async(&I2C_DefaultDevice, DS1307_REG_SECONDS, timekeeperRegs_au8, 
+											  sizeof(timekeeperRegs_au8), Bench_AsyncCallback, NULL));
+}
+
+static uint8_t Bench_IRQBurstRead(void)
+{
+	const I2C_Transfer_t transfer = { .isRead = I2C_TRANSFER_READ, .device = &I2C_DefaultDevice, 
+									  .startRegisterAddress = DS1307_REG_SECONDS, .buffer = timekeeperRegs_au8, 
+									  .length = sizeof(timekeeperRegs_au8), .callback = Bench_AsyncCallback, .context = NULL };
+
+	asyncDone = false;
+	return Bench_WaitAsync(I2C_IRQ_Submit(&transfer));
+}
+
+static uint8_t Bench_NVRAMWriteUncached(void)
+{
+	nvramPattern_au8[0]++;
+	return DS1307_NVRAM_Write(BENCH_NVRAM_TEST_OFFSET, nvramPattern_au8, sizeof(nvramPattern_au8));
+}
+
+static uint8_t Bench_NVRAMWriteCached(void)
+{
+	nvramPattern_au8[0]++;
+	return DS1307_NVRAMCache_Write(BENCH_NVRAM_TEST_OFFSET, nvramPattern_au8, sizeof(nvramPattern_au8));
+}
+
+/* Cached write followed by the flush - what a write costs when it has to reach the RTC */
+static uint8_t Bench_NVRAMWriteCachedFlush(void)
+{
+	uint8_t status = Bench_NVRAMWriteCached();
+	return (status == STATUS_SUCCESS) ? DS1307_NVRAMCache_Flush() : status;
+}
+
+int main() 
+{
+    stdio_init_all();
+
+	Reset_I2C0();
+    I2C_Initialize(I2C_STANDARD_MODE);
+	(void)setupPinsI2C0();
+	(void)Enable_DS1307_Oscillator();
+	(void)I2C_DMA_Initialize(&I2C_DefaultBus);
+	(void)I2C_IRQ_Initialize(&I2C_DefaultBus);
+	(void)DS1307_NVRAMCache_Load();
+
+    while (1) 
+    {
+		printf("# DS1307 benchmark, %u iterations per line\n", BENCH_ITERATIONS);
+		printf("BENCH,name,baudrate,iterations,failures,min_us,avg_us,max_us\n");
+
+		for(uint32_t i = 0; i < (sizeof(benchBaudrates) / sizeof(benchBaudrates[0])); i++)
+		{
+			uint32_t baudrate = benchBaudrates[i];
+			I2C_SetBaudrate(baudrate);
+
+			Bench_Run("single_register_read_x7", baudrate, Bench_SingleRegisterReads);
+			Bench_Run("burst_read_7", baudrate, Bench_BurstRead);
+			Bench_Run("read_datetime", baudrate, Bench_ReadDateTime);
+			Bench_Run("dma_burst_read_7", baudrate, Bench_DMABurstRead);
+			Bench_Run("irq_burst_read_7", baudrate, Bench_IRQBurstRead);
+			Bench_Run("nvram_write_8_uncached", baudrate, Bench_NVRAMWriteUncached);
+			Bench_Run("nvram_write_8_cached", baudrate, Bench_NVRAMWriteCached);
+			Bench_Run("nvram_write_8_cached_flush", baudrate, Bench_NVRAMWriteCachedFlush);
+		}
+
+		I2C_SetBaudrate(I2C_STANDARD_MODE);
+		printf("BENCH,END\n");
+		sleep_ms(5000);
+    }
+
+    return 0;
+}
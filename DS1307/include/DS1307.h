@@ -2,6 +2,35 @@
 #define DS1307_H
 
 #include "stdint.h"
+#include "stddef.h"
+#include "stdbool.h"
+#include "I2C_Driver.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 1 - read back and compare every write done through the register shadow (see DS1307_Dev_LoadShadow()) */
+#ifndef DS1307_SHADOW_VERIFY
+#define DS1307_SHADOW_VERIFY 0
+#endif
+#define DS1307_SHADOW_BUS_COUNT I2C_CONTROLLER_COUNT /* One DS1307 per bus (fixed address) */
+
+/* Decoded content of the timekeeper registers 00h-06h (all values in decimal) */
+typedef struct
+{
+	uint8_t seconds;	/* 0-59 */
+	uint8_t minutes;	/* 0-59 */
+	uint8_t hours;		/* 0-23 */
+	uint8_t dayOfWeek;	/* 1-7 */
+	uint8_t date;		/* 1-31 */
+	uint8_t month;		/* 1-12 */
+	uint8_t year;		/* 0-99 */
+} DS1307_DateTime_t;
+
+/* Packed time - seconds since 2000-01-01 00:00:00, see DS1307_TimestampFromRegs() */
+typedef uint32_t DS1307_Timestamp_t;
+#define DS1307_TIMESTAMP_SIZE 4 /* Bytes used by DS1307_TimestampStore() */
 
 int setupPinsI2C0();
 uint8_t SetCurrentDate(const char *buildDate, const char *buildTime);
@@ -9,6 +38,26 @@ uint8_t ConvertBCD(uint16_t valueToConvert, bool direction);
 int getMonthNumber(const char *monthAbbreviation);
 uint8_t Enable_DS1307_Oscillator();
 uint8_t Disable_DS1307_SquareWaveOutput();
+uint8_t Enable_DS1307_SquareWaveOutput(uint8_t rateSelect);
+uint8_t DS1307_ReadDateTime(DS1307_DateTime_t *dateTime);
+uint8_t DS1307_WriteDateTime(const DS1307_DateTime_t *dateTime);
+void DS1307_DecodeDateTime(const uint8_t *timekeeperRegs, DS1307_DateTime_t *dateTime);
+uint8_t DS1307_DecodeDateTimeValidated(const uint8_t *timekeeperRegs, DS1307_DateTime_t *dateTime);
+bool DS1307_IsValidDateTime(const DS1307_DateTime_t *dateTime);
+uint8_t DS1307_NVRAM_Read(uint8_t offset, uint8_t *buffer, size_t length);
+uint8_t DS1307_NVRAM_Write(uint8_t offset, const uint8_t *data, size_t length);
+uint8_t DS1307_DaysInMonth(uint8_t month, uint8_t year);
+void DS1307_AddSecond(DS1307_DateTime_t *dateTime);
+uint32_t DS1307_ToSecondsSince2000(const DS1307_DateTime_t *dateTime);
+void DS1307_FromSecondsSince2000(uint32_t secondsSince2000, DS1307_DateTime_t *dateTime);
+uint32_t DS1307_ToEpoch(const DS1307_DateTime_t *dateTime);
+uint8_t DS1307_FromEpoch(uint32_t epochSeconds, DS1307_DateTime_t *dateTime);
+uint8_t DS1307_DayOfWeek(uint8_t year, uint8_t month, uint8_t date);
+DS1307_Timestamp_t DS1307_TimestampFromRegs(const uint8_t *timekeeperRegs);
+void DS1307_TimestampToRegs(DS1307_Timestamp_t timestamp, uint8_t *timekeeperRegs);
+void DS1307_TimestampStore(DS1307_Timestamp_t timestamp, uint8_t *bytes);
+DS1307_Timestamp_t DS1307_TimestampLoad(const uint8_t *bytes);
+uint8_t DS1307_ReadTimestamp(DS1307_Timestamp_t *timestamp);
 
 #define INCORRECT_MONTH (0xFF)
 #define INCORRECT_REQUEST (0xFF)
@@ -17,5 +66,137 @@ uint8_t Disable_DS1307_SquareWaveOutput();
 #define LOWER_NIBBLE_MASK 0x0F
 #define CH_BIT_REG_0_READ_MASK 0x80
 #define CH_BIT_REG_0_CLEAR_MASK 0x7F
+#define HOURS_24H_MODE_MASK 0x3F
+#define HOURS_12H_MODE_BIT 0x40
+#define HOURS_12H_PM_BIT 0x20
+#define HOURS_12H_MODE_MASK 0x1F
+#define DS1307_REG_SECONDS 0x00
+#define DS1307_TIMEKEEPER_REGS_LENGTH 7 /* 00h to 06h */
+#define DS1307_REG_CONTROL 0x07
+#define CONTROL_REG_OUT_BIT 0x80
+#define CONTROL_REG_SQWE_BIT 0x10
+#define CONTROL_REG_RS_1HZ 0x00
+#define CONTROL_REG_RS_4096HZ 0x01
+#define CONTROL_REG_RS_8192HZ 0x02
+#define CONTROL_REG_RS_32768HZ 0x03
+#define CONTROL_REG_RS_MASK 0x03
+#define DS1307_NVRAM_START 0x08
+#define DS1307_NVRAM_SIZE 56 /* 08h to 3Fh */
+
+/** BCD codec - used for every field on every read, so no division: decoding is a multiply by 10 (shift+add on the M0+)
+ *  and encoding divides by 10 with a multiply-shift ((x * 205) >> 11 == x / 10 for all x < 1029). 
+ *  The _CONST variants are meant for constant inputs and are folded by the compiler. 
+*/
+#define DS1307_BCD_TO_DEC_CONST(bcd) ((uint8_t)((((bcd) >> 4) * 10) + ((bcd) & LOWER_NIBBLE_MASK)))
+#define DS1307_DEC_TO_BCD_CONST(dec) ((uint8_t)((((dec) / 10) << 4) | ((dec) % 10)))
+
+static inline uint8_t DS1307_BcdToDec(uint8_t bcd)
+{
+	uint32_t tens = bcd >> 4;
+	return (uint8_t)((tens << 3) + (tens << 1) + (bcd & LOWER_NIBBLE_MASK));
+}
+
+/* Valid for 0-99 (two BCD digits) */
+static inline uint8_t DS1307_DecToBcd(uint8_t dec)
+{
+	uint32_t tens = ((uint32_t)dec * 205u) >> 11;
+	return (uint8_t)((tens << 4) | (dec - (tens * 10u)));
+}
+
+/** Typed accessors of the raw timekeeper block (00h-06h, as burst read) - every flag bit is masked here, so callers 
+ *  never see the CH bit in the seconds or the 12h/PM bits in the hours.
+ *  Hours register (02h): bit 6 = 1 - 12-hour mode, bit 5 = PM, bits 4-0 = hour 1-12 (BCD),
+ *                        bit 6 = 0 - 24-hour mode, bits 5-0 = hour 0-23 (BCD).
+*/
+static inline bool DS1307_Reg_ClockHalted(const uint8_t *timekeeperRegs)
+{
+	return (timekeeperRegs[0] & CH_BIT_REG_0_READ_MASK) != 0;
+}
+
+static inline uint8_t DS1307_Reg_Seconds(const uint8_t *timekeeperRegs)
+{
+	return DS1307_BcdToDec(timekeeperRegs[0] & CH_BIT_REG_0_CLEAR_MASK);
+}
+
+static inline uint8_t DS1307_Reg_Minutes(const uint8_t *timekeeperRegs)
+{
+	return DS1307_BcdToDec(timekeeperRegs[1]);
+}
+
+static inline bool DS1307_Reg_Is12HourMode(const uint8_t *timekeeperRegs)
+{
+	return (timekeeperRegs[2] & HOURS_12H_MODE_BIT) != 0;
+}
+
+/* true - PM (12-hour mode), in 24-hour mode derived from the hour */
+static inline bool DS1307_Reg_IsPM(const uint8_t *timekeeperRegs)
+{
+	return DS1307_Reg_Is12HourMode(timekeeperRegs) ? ((timekeeperRegs[2] & HOURS_12H_PM_BIT) != 0) 
+												   : (DS1307_BcdToDec(timekeeperRegs[2] & HOURS_24H_MODE_MASK) >= 12);
+}
+
+/* Hours 0-23 in either mode, without branches: 12 AM -> 0, 1-11 AM -> 1-11, 12 PM -> 12, 1-11 PM -> 13-23 */
+static inline uint8_t DS1307_Reg_Hours24(const uint8_t *timekeeperRegs)
+{
+	uint32_t reg = timekeeperRegs[2];
+	uint32_t mode12h = (reg >> 6) & 1u;
+	uint32_t pm = (reg >> 5) & mode12h;
+	uint32_t hours = DS1307_BcdToDec((uint8_t)(reg & (HOURS_12H_MODE_MASK | ((mode12h ^ 1u) << 5))));
+
+	return (uint8_t)(hours - (mode12h * (hours == 12u) * 12u) + (pm * 12u));
+}
+
+static inline uint8_t DS1307_Reg_DayOfWeek(const uint8_t *timekeeperRegs)
+{
+	return timekeeperRegs[3] & 0x07;
+}
+
+static inline uint8_t DS1307_Reg_Date(const uint8_t *timekeeperRegs)
+{
+	return DS1307_BcdToDec(timekeeperRegs[4] & 0x3F);
+}
+
+static inline uint8_t DS1307_Reg_Month(const uint8_t *timekeeperRegs)
+{
+	return DS1307_BcdToDec(timekeeperRegs[5] & 0x1F);
+}
+
+static inline uint8_t DS1307_Reg_Year(const uint8_t *timekeeperRegs)
+{
+	return DS1307_BcdToDec(timekeeperRegs[6]);
+}
+
+/* Hours register value for 'hours24' (0-23) in 12-hour mode */
+static inline uint8_t DS1307_EncodeHours12(uint8_t hours24)
+{
+	uint32_t pm = (hours24 >= 12u);
+	uint32_t hours12 = hours24 - (pm * 12u);
+
+	hours12 += (hours12 == 0) * 12u;
+	return (uint8_t)(HOURS_12H_MODE_BIT | (pm << 5) | DS1307_DecToBcd((uint8_t)hours12));
+}
+
+/* Same as the functions above, for a DS1307 on any bus (see I2C_Bus_Init()/I2C_Device_Init()) */
+uint8_t DS1307_Dev_EnableOscillator(I2C_Device_t *rtc);
+uint8_t DS1307_Dev_EnableSquareWaveOutput(I2C_Device_t *rtc, uint8_t rateSelect);
+uint8_t DS1307_Dev_SetControl(I2C_Device_t *rtc, uint8_t value);
+uint8_t DS1307_Dev_SetOutputLevel(I2C_Device_t *rtc, bool high);
+uint8_t DS1307_Dev_HaltOscillator(I2C_Device_t *rtc);
+uint8_t DS1307_Dev_IsOscillatorHalted(I2C_Device_t *rtc, bool *halted);
+uint8_t DS1307_Dev_GetControl(I2C_Device_t *rtc, uint8_t *value);
+uint8_t DS1307_Dev_LoadShadow(I2C_Device_t *rtc);
+void DS1307_Dev_InvalidateShadow(I2C_Device_t *rtc);
+bool DS1307_Dev_Is12HourMode(I2C_Device_t *rtc);
+uint8_t DS1307_Dev_ReadDateTime(I2C_Device_t *rtc, DS1307_DateTime_t *dateTime);
+uint8_t DS1307_Dev_WriteDateTime(I2C_Device_t *rtc, const DS1307_DateTime_t *dateTime);
+uint8_t DS1307_Dev_WriteTimekeeperRegs(I2C_Device_t *rtc, const uint8_t *timekeeperRegs);
+uint8_t DS1307_Dev_SetHourMode(I2C_Device_t *rtc, bool mode12h);
+uint8_t DS1307_Dev_ReadTimestamp(I2C_Device_t *rtc, DS1307_Timestamp_t *timestamp);
+uint8_t DS1307_Dev_NVRAM_Read(I2C_Device_t *rtc, uint8_t offset, uint8_t *buffer, size_t length);
+uint8_t DS1307_Dev_NVRAM_Write(I2C_Device_t *rtc, uint8_t offset, const uint8_t *data, size_t length);
+
+#ifdef __cplusplus
+}
+#endif
 
 #endif /* DS1307_H */
@@ -0,0 +1,460 @@
+#ifndef DS1307_HPP
+#define DS1307_HPP
+
+/**
+ * Header-only C++17 interface of the DS1307 driver - a thin layer over the C API, no state of its own.
+ *
+ * - ds1307::DS1307<Bus> is parameterized with a bus policy, chosen at compile time:
+ *     BlockingBus - the bounded blocking transaction layer (I2C_Dev_Burst_Read/Write)
+ *     DmaBus      - DMA driven transfers (I2C_DMA.h), IrqBus - interrupt driven transfers (I2C_IRQ.h)
+ *     MockBus     - the emulated DS1307 of DS1307_Mock.h, no I2C at all (constructed with the mock - no default)
+ *   Every policy provides blocking read()/write(). The asynchronous ones (DmaBus, IrqBus) also provide
+ *   readAsync()/writeAsync() and the class offers them only for those policies (static_assert).
+ *   Stateless policies take no space (empty base), all members are inline - each call compiles to the same
+ *   C call a hand-written one would be.
+ * - Register addresses and bit masks are constexpr (ds1307::reg, ds1307::bits).
+ * - Results are [[nodiscard]]: Status separates the error from the data - a register read returns the value and
+ *   the status apart, so a register holding 0xFF is no longer mistaken for MPU6050_REGISTER_I2C_READ_FAIL.
+ * - The register shadow of DS1307.c stays coherent: with BlockingBus the oscillator, control and time writes are
+ *   the C DS1307_Dev_ functions, the other policies (and every raw write to 00h-07h) invalidate the shadow.
+ * - The blocking read()/write() of DmaBus/IrqBus are bounded by the retry policy of the bus (attemptTimeoutBaseUs +
+ *   perByteTimeoutUs per byte) - after that the transfer is cancelled and Status::BusError returned.
+ * Needs the DS1307_LIB library (C) - link it as usual.
+*/
+
+#include <cstdint>
+#include <cstddef>
+#include "pico/stdlib.h"
+#include "DS1307.h"
+#include "DS1307_Mock.h"
+#include "I2C_Driver.h"
+#include "I2C_DMA.h"
+#include "I2C_IRQ.h"
+
+namespace ds1307
+{
+
+/* Register map (DS1307 Datasheet Table 2) */
+namespace reg
+{
+	inline constexpr uint8_t Seconds = DS1307_REG_SECONDS;
+	inline constexpr uint8_t Minutes = 0x01;
+	inline constexpr uint8_t Hours = 0x02;
+	inline constexpr uint8_t DayOfWeek = 0x03;
+	inline constexpr uint8_t Date = 0x04;
+	inline constexpr uint8_t Month = 0x05;
+	inline constexpr uint8_t Year = 0x06;
+	inline constexpr uint8_t Control = DS1307_REG_CONTROL;
+	inline constexpr uint8_t NvramStart = DS1307_NVRAM_START;
+	inline constexpr uint8_t NvramSize = DS1307_NVRAM_SIZE;
+	inline constexpr uint8_t TimekeeperLength = DS1307_TIMEKEEPER_REGS_LENGTH;
+	inline constexpr uint8_t MapSize = 64;
+}
+
+namespace bits
+{
+	inline constexpr uint8_t ClockHalt = CH_BIT_REG_0_READ_MASK;
+	inline constexpr uint8_t Hours12hMode = HOURS_12H_MODE_BIT;
+	inline constexpr uint8_t HoursPm = HOURS_12H_PM_BIT;
+	inline constexpr uint8_t ControlOut = CONTROL_REG_OUT_BIT;
+	inline constexpr uint8_t ControlSqwe = CONTROL_REG_SQWE_BIT;
+	inline constexpr uint8_t ControlRateMask = CONTROL_REG_RS_MASK;
+}
+
+enum class SquareWaveRate : uint8_t
+{
+	Rate1Hz = CONTROL_REG_RS_1HZ,
+	Rate4096Hz = CONTROL_REG_RS_4096HZ,
+	Rate8192Hz = CONTROL_REG_RS_8192HZ,
+	Rate32768Hz = CONTROL_REG_RS_32768HZ
+};
+
+enum class [[nodiscard]] Status : uint8_t
+{
+	Success = STATUS_SUCCESS,
+	Failure = STAUS_FAILURE,
+	Busy = STATUS_BUSY,
+	BusError = MPU6050_REGISTER_I2C_READ_FAIL	/* Details: I2C_Bus_GetLastError() */
+};
+
+constexpr bool IsOk(Status status)
+{
+	return status == Status::Success;
+}
+
+constexpr Status ToStatus(uint8_t cStatus)
+{
+	return static_cast<Status>(cStatus);
+}
+
+/* A value together with the status of the operation that produced it ('value' is only valid if ok()) */
+template <typename T>
+struct [[nodiscard]] Result
+{
+	T value;
+	Status status;
+
+	constexpr bool ok() const { return IsOk(status); }
+};
+
+/* Blocking transfers through the bounded transaction layer (retries, timeouts, error details) */
+struct BlockingBus
+{
+	static constexpr bool asynchronous = false;
+	static constexpr bool transactionLayer = true;	/* The C DS1307_Dev_ functions use the same path */
+
+	Status read(I2C_Device_t &device, uint8_t startRegister, uint8_t *buffer, size_t length) const
+	{
+		return ToStatus(I2C_Dev_Burst_Read(&device, startRegister, buffer, length));
+	}
+
+	Status write(I2C_Device_t &device, uint8_t startRegister, const uint8_t *data, size_t length) const
+	{
+		return ToStatus(I2C_Dev_Burst_Write(&device, startRegister, data, length));
+	}
+};
+
+namespace detail
+{
+	struct Completion
+	{
+		volatile bool done;
+		volatile uint8_t status;
+	};
+
+	inline void OnComplete(uint8_t status, void *context)
+	{
+		Completion *completion = static_cast<Completion *>(context);
+		completion->status = status;
+		completion->done = true;
+	}
+
+	/* Deadline of one transfer (register pointer + 'length' bytes) from the retry policy of the bus */
+	inline uint32_t TimeoutUs(const I2C_Bus_t &bus, size_t length)
+	{
+		return bus.retryPolicy.attemptTimeoutBaseUs + (bus.retryPolicy.perByteTimeoutUs * static_cast<uint32_t>(length + 1));
+	}
+
+	/** Blocking use of an async engine. The engines call back on completion, NACK and arbitration loss, but a 
+	 *  slave holding SCL low stalls the transfer for good - after 'timeoutUs' it is cancelled ('cancel' calls the 
+	 *  engine's Cancel(), which completes it with a bus error). If the cancel finds it already done, its result counts.
+	*/
+	template <typename Cancel>
+	inline Status Wait(Status submitStatus, Completion &completion, uint32_t timeoutUs, Cancel cancel)
+	{
+		if(!IsOk(submitStatus))
+		{
+			return submitStatus;
+		}
+
+		absolute_time_t deadline = make_timeout_time_us(timeoutUs);
+		while(!completion.done)
+		{
+			if(time_reached(deadline) && IsOk(ToStatus(cancel())))
+			{
+				return Status::BusError;
+			}
+			tight_loop_contents();
+		}
+		return ToStatus(completion.status);
+	}
+}
+
+/* DMA transfers (I2C_DMA_Initialize() must have been called for the bus) */
+struct DmaBus
+{
+	static constexpr bool asynchronous = true;
+	static constexpr bool transactionLayer = false;
+
+	Status readAsync(I2C_Device_t &device, uint8_t startRegister, uint8_t *buffer, size_t length,
+					 I2C_TransferCallback_t callback, void *context) const
+	{
+		return ToStatus(I2C_DMA_Read_Async(&device, startRegister, buffer, length, callback, context));
+	}
+
+	Status writeAsync(I2C_Device_t &device, uint8_t startRegister, const uint8_t *data, size_t length,
+					  I2C_TransferCallback_t callback, void *context) const
+	{
+		return ToStatus(I2C_DMA_Write_Async(&device, startRegister, data, length, callback, context));
+	}
+
+	Status read(I2C_Device_t &device, uint8_t startRegister, uint8_t *buffer, size_t length) const
+	{
+		detail::Completion completion = { false, STATUS_SUCCESS };
+		return detail::Wait(readAsync(device, startRegister, buffer, length, detail::OnComplete, &completion), completion,
+							detail::TimeoutUs(*device.bus, length), [&] { return I2C_DMA_Cancel(device.bus, &completion); });
+	}
+
+	Status write(I2C_Device_t &device, uint8_t startRegister, const uint8_t *data, size_t length) const
+	{
+		detail::Completion completion = { false, STATUS_SUCCESS };
+		return detail::Wait(writeAsync(device, startRegister, data, length, detail::OnComplete, &completion), completion,
+							detail::TimeoutUs(*device.bus, length), [&] { return I2C_DMA_Cancel(device.bus, &completion); });
+	}
+};
+
+/* Interrupt driven, queued transfers (I2C_IRQ_Initialize() must have been called for the bus) */
+struct IrqBus
+{
+	static constexpr bool asynchronous = true;
+	static constexpr bool transactionLayer = false;
+
+	Status readAsync(I2C_Device_t &device, uint8_t startRegister, uint8_t *buffer, size_t length,
+					 I2C_TransferCallback_t callback, void *context) const
+	{
+		const I2C_Transfer_t transfer = { I2C_TRANSFER_READ, &device, startRegister, buffer, length, callback, context };
+		return ToStatus(I2C_IRQ_Submit(&transfer));
+	}
+
+	/* The queue keeps a pointer to 'data' - it must stay valid until the callback */
+	Status writeAsync(I2C_Device_t &device, uint8_t startRegister, const uint8_t *data, size_t length,
+					  I2C_TransferCallback_t callback, void *context) const
+	{
+		const I2C_Transfer_t transfer = { I2C_TRANSFER_WRITE, &device, startRegister, const_cast<uint8_t *>(data), length, callback, context };
+		return ToStatus(I2C_IRQ_Submit(&transfer));
+	}
+
+	Status read(I2C_Device_t &device, uint8_t startRegister, uint8_t *buffer, size_t length) const
+	{
+		detail::Completion completion = { false, STATUS_SUCCESS };
+		Status status = readAsync(device, startRegister, buffer, length, detail::OnComplete, &completion);
+		return detail::Wait(status, completion, QueuedTimeoutUs(device, length), [&] { return I2C_IRQ_Cancel(device.bus, &completion); });
+	}
+
+	Status write(I2C_Device_t &device, uint8_t startRegister, const uint8_t *data, size_t length) const
+	{
+		detail::Completion completion = { false, STATUS_SUCCESS };
+		Status status = writeAsync(device, startRegister, data, length, detail::OnComplete, &completion);
+		return detail::Wait(status, completion, QueuedTimeoutUs(device, length), [&] { return I2C_IRQ_Cancel(device.bus, &completion); });
+	}
+
+private:
+	/* Own transfer plus the ones queued ahead of it (at most a full burst each) */
+	static uint32_t QueuedTimeoutUs(const I2C_Device_t &device, size_t length)
+	{
+		uint32_t pending = I2C_IRQ_PendingCount(device.bus);
+		uint32_t ahead = (pending > 0) ? (pending - 1) : 0;
+		return detail::TimeoutUs(*device.bus, length) + (ahead * detail::TimeoutUs(*device.bus, I2C_BURST_MAX_LENGTH));
+	}
+};
+
+/* The emulated DS1307 (DS1307_Mock.h) called directly - same register semantics, no bus, no retries */
+class MockBus
+{
+public:
+	static constexpr bool asynchronous = false;
+	static constexpr bool transactionLayer = false;	/* Talks to the mock directly, not through device.bus */
+
+	MockBus() = delete;
+	explicit MockBus(DS1307_Mock_t &mock) : mock(&mock) {}
+
+	Status read(I2C_Device_t &device, uint8_t startRegister, uint8_t *buffer, size_t length) const
+	{
+		return (DS1307_Mock_Transfer(mock, device.address, &startRegister, 1, buffer, length) == I2C_ERROR_NONE) ?
+			   Status::Success : Status::BusError;
+	}
+
+	Status write(I2C_Device_t &device, uint8_t startRegister, const uint8_t *data, size_t length) const
+	{
+		uint8_t txBuffer[reg::MapSize + 1];
+
+		if(length > reg::MapSize)
+		{
+			return Status::Failure;
+		}
+		txBuffer[0] = startRegister;
+		for(size_t i = 0; i < length; i++)
+		{
+			txBuffer[i + 1] = data[i];
+		}
+		return (DS1307_Mock_Transfer(mock, device.address, txBuffer, length + 1, nullptr, 0) == I2C_ERROR_NONE) ?
+			   Status::Success : Status::BusError;
+	}
+
+private:
+	DS1307_Mock_t *mock;
+};
+
+template <typename Bus = BlockingBus>
+class DS1307 : private Bus
+{
+public:
+	/* DS1307<MockBus> has no default - it needs the mock: DS1307<MockBus> rtc(device, MockBus(mock)) */
+	explicit DS1307(I2C_Device_t &device = I2C_DefaultDevice, Bus bus = Bus{}) : Bus(bus), device_(device) {}
+
+	I2C_Device_t &device() const { return device_; }
+
+	Status readRegisters(uint8_t startRegister, uint8_t *buffer, size_t length) const
+	{
+		return Bus::read(device_, startRegister, buffer, length);
+	}
+
+	/* Raw write - a write to 00h-07h (also by wrapping past 3Fh) invalidates the register shadow of DS1307.c */
+	Status writeRegisters(uint8_t startRegister, const uint8_t *data, size_t length) const
+	{
+		Status status = Bus::write(device_, startRegister, data, length);
+
+		if((startRegister <= reg::Control) || ((startRegister + length) > reg::MapSize))
+		{
+			DS1307_Dev_InvalidateShadow(&device_);
+		}
+		return status;
+	}
+
+	Result<uint8_t> readRegister(uint8_t registerAddress) const
+	{
+		uint8_t value = 0;
+		Status status = readRegisters(registerAddress, &value, 1);
+		return { value, status };
+	}
+
+	Status writeRegister(uint8_t registerAddress, uint8_t value) const
+	{
+		return writeRegisters(registerAddress, &value, 1);
+	}
+
+	/* One burst read of 00h-06h, decoded (12/24-hour mode aware) */
+	Result<DS1307_DateTime_t> readDateTime() const
+	{
+		uint8_t timekeeperRegs[reg::TimekeeperLength];
+		Result<DS1307_DateTime_t> result = { {}, readRegisters(reg::Seconds, timekeeperRegs, sizeof(timekeeperRegs)) };
+
+		if(result.ok())
+		{
+			DS1307_DecodeDateTime(timekeeperRegs, &result.value);
+		}
+		return result;
+	}
+
+	/* Same, but fails (Status::Failure) on register content that isn't a valid date/time */
+	Result<DS1307_DateTime_t> readValidatedDateTime() const
+	{
+		uint8_t timekeeperRegs[reg::TimekeeperLength];
+		Result<DS1307_DateTime_t> result = { {}, readRegisters(reg::Seconds, timekeeperRegs, sizeof(timekeeperRegs)) };
+
+		if(result.ok())
+		{
+			result.status = ToStatus(DS1307_DecodeDateTimeValidated(timekeeperRegs, &result.value));
+		}
+		return result;
+	}
+
+	Result<DS1307_Timestamp_t> readTimestamp() const
+	{
+		uint8_t timekeeperRegs[reg::TimekeeperLength];
+		Status status = readRegisters(reg::Seconds, timekeeperRegs, sizeof(timekeeperRegs));
+
+		return { IsOk(status) ? DS1307_TimestampFromRegs(timekeeperRegs) : 0, status };
+	}
+
+	/* 24-hour mode, CH cleared (the oscillator runs) */
+	Status writeDateTime(const DS1307_DateTime_t &dateTime) const
+	{
+		const uint8_t timekeeperRegs[reg::TimekeeperLength] = {
+			DS1307_DecToBcd(dateTime.seconds), DS1307_DecToBcd(dateTime.minutes), DS1307_DecToBcd(dateTime.hours),
+			DS1307_DecToBcd(dateTime.dayOfWeek), DS1307_DecToBcd(dateTime.date), DS1307_DecToBcd(dateTime.month),
+			DS1307_DecToBcd(dateTime.year)
+		};
+		return writeTimekeeperRegs(timekeeperRegs);
+	}
+
+	Status writeTimestamp(DS1307_Timestamp_t timestamp) const
+	{
+		uint8_t timekeeperRegs[reg::TimekeeperLength];
+
+		DS1307_TimestampToRegs(timestamp, timekeeperRegs);
+		return writeTimekeeperRegs(timekeeperRegs);
+	}
+
+	/* 'offset' relative to the start of the NVRAM (0-55) */
+	Status readNvram(uint8_t offset, uint8_t *buffer, size_t length) const
+	{
+		if((length == 0) || ((offset + length) > reg::NvramSize))
+		{
+			return Status::Failure;
+		}
+		return readRegisters(static_cast<uint8_t>(reg::NvramStart + offset), buffer, length);
+	}
+
+	Status writeNvram(uint8_t offset, const uint8_t *data, size_t length) const
+	{
+		if((length == 0) || ((offset + length) > reg::NvramSize))
+		{
+			return Status::Failure;
+		}
+		return writeRegisters(static_cast<uint8_t>(reg::NvramStart + offset), data, length);
+	}
+
+	/* Clear CH - no-op write skipped if it already runs (with BlockingBus no read either once the shadow is loaded) */
+	Status enableOscillator() const
+	{
+		if constexpr (Bus::transactionLayer)
+		{
+			return ToStatus(DS1307_Dev_EnableOscillator(&device_));
+		}
+
+		Result<uint8_t> seconds = readRegister(reg::Seconds);
+
+		if(!seconds.ok() || !(seconds.value & bits::ClockHalt))
+		{
+			return seconds.status;
+		}
+		return writeRegister(reg::Seconds, static_cast<uint8_t>(seconds.value & ~bits::ClockHalt));
+	}
+
+	Status enableSquareWave(SquareWaveRate rate) const
+	{
+		if constexpr (Bus::transactionLayer)
+		{
+			return ToStatus(DS1307_Dev_EnableSquareWaveOutput(&device_, static_cast<uint8_t>(rate)));
+		}
+		return writeRegister(reg::Control, static_cast<uint8_t>(bits::ControlSqwe | static_cast<uint8_t>(rate)));
+	}
+
+	/* SQW/OUT as a static output (SQWE = 0) - keeps the rate select bits */
+	Status setOutputLevel(bool high) const
+	{
+		if constexpr (Bus::transactionLayer)
+		{
+			return ToStatus(DS1307_Dev_SetOutputLevel(&device_, high));
+		}
+
+		Result<uint8_t> control = readRegister(reg::Control);
+
+		if(!control.ok())
+		{
+			return control.status;
+		}
+		return writeRegister(reg::Control, static_cast<uint8_t>((control.value & bits::ControlRateMask) | (high ? bits::ControlOut : 0)));
+	}
+
+	/* Asynchronous transfers - only with DmaBus/IrqBus. The callback runs in interrupt context */
+	Status readRegistersAsync(uint8_t startRegister, uint8_t *buffer, size_t length, I2C_TransferCallback_t callback, void *context) const
+	{
+		static_assert(Bus::asynchronous, "readRegistersAsync() needs an asynchronous bus policy (DmaBus, IrqBus)");
+		return Bus::readAsync(device_, startRegister, buffer, length, callback, context);
+	}
+
+	Status writeRegistersAsync(uint8_t startRegister, const uint8_t *data, size_t length, I2C_TransferCallback_t callback, void *context) const
+	{
+		static_assert(Bus::asynchronous, "writeRegistersAsync() needs an asynchronous bus policy (DmaBus, IrqBus)");
+		return Bus::writeAsync(device_, startRegister, data, length, callback, context);
+	}
+
+private:
+	/* 00h-06h block (BCD) - through DS1307_Dev_WriteTimekeeperRegs() with BlockingBus, which updates the shadow */
+	Status writeTimekeeperRegs(const uint8_t *timekeeperRegs) const
+	{
+		if constexpr (Bus::transactionLayer)
+		{
+			return ToStatus(DS1307_Dev_WriteTimekeeperRegs(&device_, timekeeperRegs));
+		}
+		return writeRegisters(reg::Seconds, timekeeperRegs, reg::TimekeeperLength);
+	}
+
+	I2C_Device_t &device_;
+};
+
+} /* namespace ds1307 */
+
+#endif /* DS1307_HPP */
@@ -0,0 +1,32 @@
+#ifndef DS1307_ALARM_H
+#define DS1307_ALARM_H
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "DS1307.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DS1307_ALARM_MAX_COUNT		256 /* Max number of scheduled alarms */
+#define DS1307_ALARM_INVALID_ID		(-1)
+#define DS1307_ALARM_ONE_SHOT		0   /* periodSeconds value of alarms that fire once */
+
+/* Called from the SQW interrupt (via the cached clock tick) - keep it short */
+typedef void (*DS1307_AlarmCallback_t)(int32_t alarmId, uint32_t secondsSince2000, void *context);
+
+void DS1307_Alarm_Start();
+void DS1307_Alarm_Stop();
+int32_t DS1307_Alarm_Add(uint32_t dueSecondsSince2000, uint32_t periodSeconds, DS1307_AlarmCallback_t callback, void *context);
+int32_t DS1307_Alarm_AddAt(const DS1307_DateTime_t *dueDateTime, uint32_t periodSeconds, DS1307_AlarmCallback_t callback, void *context);
+int32_t DS1307_Alarm_AddIn(uint32_t delaySeconds, uint32_t periodSeconds, DS1307_AlarmCallback_t callback, void *context);
+uint8_t DS1307_Alarm_Cancel(int32_t alarmId);
+void DS1307_Alarm_Tick(uint32_t secondsSince2000);
+uint32_t DS1307_Alarm_Count();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DS1307_ALARM_H */
@@ -0,0 +1,34 @@
+#ifndef DS1307_BATCH_H
+#define DS1307_BATCH_H
+
+#include "stdint.h"
+#include "stddef.h"
+#include "DS1307.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DS1307_REGISTER_MAP_SIZE	64 /* 00h-3Fh - the register pointer wraps from 3Fh to 00h */
+/* Unrequested registers up to this many between two ranges are read too - cheaper than the ~4 byte overhead 
+ * (slave address + register pointer + repeated START address, START/STOP) of another transaction */
+#define DS1307_BATCH_MERGE_GAP		3
+#define DS1307_BATCH_MAX_TRANSFERS	8
+
+/* One requested block: 'length' registers from 'startRegister' (may wrap past 3Fh) into 'buffer' */
+typedef struct
+{
+	uint8_t startRegister;
+	uint8_t length;
+	uint8_t *buffer;
+} DS1307_BatchRange_t;
+
+uint8_t DS1307_Dev_BatchRead(I2C_Device_t *rtc, const DS1307_BatchRange_t *ranges, size_t rangeCount);
+uint8_t DS1307_BatchRead(const DS1307_BatchRange_t *ranges, size_t rangeCount);
+uint8_t DS1307_Dev_ReadDateTimeAndNVRAM(I2C_Device_t *rtc, DS1307_DateTime_t *dateTime, uint8_t nvramOffset, uint8_t *nvramBuffer, size_t nvramLength);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DS1307_BATCH_H */
@@ -0,0 +1,70 @@
+#ifndef DS1307_BUILD_TIME_H
+#define DS1307_BUILD_TIME_H
+
+/**
+ * Build date/time (__DATE__ = "Mmm dd yyyy", __TIME__ = "hh:mm:ss") turned into the DS1307 register values by the 
+ * preprocessor/compiler - no sscanf/strcmp at runtime. Everything below folds to constants.
+ * 
+ * The macros expand where they are used, so DS1307_SetBuildDateTime() sets the RTC to the build time of the 
+ * application, not of the library.
+*/
+
+#include "stdint.h"
+#include "DS1307.h"
+#include "I2C_Driver.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BUILD_DIGIT(str, idx)	((str)[idx] == ' ' ? 0 : ((str)[idx] - '0'))
+
+#define BUILD_MONTH ( \
+	(__DATE__[0] == 'J' && __DATE__[1] == 'a') ? 1 :  \
+	(__DATE__[0] == 'F')                       ? 2 :  \
+	(__DATE__[0] == 'M' && __DATE__[2] == 'r') ? 3 :  \
+	(__DATE__[0] == 'A' && __DATE__[1] == 'p') ? 4 :  \
+	(__DATE__[0] == 'M')                       ? 5 :  \
+	(__DATE__[0] == 'J' && __DATE__[2] == 'n') ? 6 :  \
+	(__DATE__[0] == 'J')                       ? 7 :  \
+	(__DATE__[0] == 'A')                       ? 8 :  \
+	(__DATE__[0] == 'S')                       ? 9 :  \
+	(__DATE__[0] == 'O')                       ? 10 : \
+	(__DATE__[0] == 'N')                       ? 11 : 12)
+#define BUILD_DAY		((BUILD_DIGIT(__DATE__, 4) * 10) + BUILD_DIGIT(__DATE__, 5))
+#define BUILD_YEAR		((BUILD_DIGIT(__DATE__, 7) * 1000) + (BUILD_DIGIT(__DATE__, 8) * 100) + \
+						 (BUILD_DIGIT(__DATE__, 9) * 10) + BUILD_DIGIT(__DATE__, 10))
+#define BUILD_HOURS		((BUILD_DIGIT(__TIME__, 0) * 10) + BUILD_DIGIT(__TIME__, 1))
+#define BUILD_MINUTES	((BUILD_DIGIT(__TIME__, 3) * 10) + BUILD_DIGIT(__TIME__, 4))
+#define BUILD_SECONDS	((BUILD_DIGIT(__TIME__, 6) * 10) + BUILD_DIGIT(__TIME__, 7))
+
+/* Sakamoto's algorithm, 0 = Sunday. The DS1307 day register is 1-7, here 1 = Sunday */
+#define BUILD_SAKAMOTO_YEAR	(BUILD_YEAR - (BUILD_MONTH < 3))
+#define BUILD_DAY_OF_WEEK	(((BUILD_SAKAMOTO_YEAR + (BUILD_SAKAMOTO_YEAR / 4) - (BUILD_SAKAMOTO_YEAR / 100) + \
+							   (BUILD_SAKAMOTO_YEAR / 400) + "\x00\x03\x02\x05\x00\x03\x05\x01\x04\x06\x02\x04"[BUILD_MONTH - 1] + \
+							   BUILD_DAY) % 7) + 1)
+
+/* Register 00h-06h content of the build time (CH bit cleared - the oscillator runs) */
+#define DS1307_BUILD_TIMEKEEPER_REGS {									\
+								DS1307_DEC_TO_BCD_CONST(BUILD_SECONDS),	\
+								DS1307_DEC_TO_BCD_CONST(BUILD_MINUTES),	\
+								DS1307_DEC_TO_BCD_CONST(BUILD_HOURS),	\
+								DS1307_DEC_TO_BCD_CONST(BUILD_DAY_OF_WEEK),	\
+								DS1307_DEC_TO_BCD_CONST(BUILD_DAY),		\
+								DS1307_DEC_TO_BCD_CONST(BUILD_MONTH),	\
+								DS1307_DEC_TO_BCD_CONST(BUILD_YEAR % 100)	\
+								}
+
+/* Set the RTC to the build time with a single burst write of constant data */
+static inline uint8_t DS1307_SetBuildDateTime()
+{
+	const uint8_t timekeeperRegs_au8[DS1307_TIMEKEEPER_REGS_LENGTH] = DS1307_BUILD_TIMEKEEPER_REGS;
+
+	return DS1307_Dev_WriteTimekeeperRegs(&I2C_DefaultDevice, timekeeperRegs_au8);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DS1307_BUILD_TIME_H */
@@ -0,0 +1,34 @@
+#ifndef DS1307_CLOCK_H
+#define DS1307_CLOCK_H
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "DS1307.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DS1307_CLOCK_DEFAULT_RESYNC_INTERVAL_S	3600 /* Resync the RAM shadow with the RTC once per hour */
+#define DS1307_CLOCK_MAX_TRIM_PPB				500000 /* +-500ppm - far beyond any crystal, DS1307_Clock_SetTrim() clamps to it */
+
+/* Called from the SQW interrupt with the new RTC time (seconds since 2000-01-01 00:00:00) */
+typedef void (*DS1307_ClockTickHook_t)(uint32_t secondsSince2000);
+
+uint8_t DS1307_Clock_Start(uint32_t sqwGpio, uint32_t resyncIntervalSeconds);
+void DS1307_Clock_Stop();
+uint8_t DS1307_Clock_Service();
+void DS1307_Clock_GetDateTime(DS1307_DateTime_t *dateTime);
+uint32_t DS1307_Clock_GetTickCount();
+uint64_t DS1307_Clock_GetTimestampUs();
+uint32_t DS1307_Clock_GetSeconds();
+void DS1307_Clock_SetTickHook(DS1307_ClockTickHook_t hook);
+void DS1307_Clock_SetTrim(uint64_t anchorUs, int64_t offsetUs, int32_t driftPpb);
+uint64_t DS1307_Clock_GetCorrectedTimestampUs();
+void DS1307_Clock_GetLastEdge(uint32_t *secondsSince2000, uint64_t *edgeTimeUs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DS1307_CLOCK_H */
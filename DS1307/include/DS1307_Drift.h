@@ -0,0 +1,32 @@
+#ifndef DS1307_DRIFT_H
+#define DS1307_DRIFT_H
+
+#include "stdint.h"
+#include "stdbool.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DS1307_DRIFT_WINDOW			32 /* Samples in the least-squares fit - older ones are dropped (temperature changes) */
+#define DS1307_DRIFT_MIN_SAMPLES	2  /* Samples needed before a drift is estimated */
+#define DS1307_DRIFT_MIN_SPAN_S		600 /* Reference time the samples must cover - see DS1307_DRIFT_MIN_SUM_XX */
+/** Least-squares spread (sum of squared reference deviations, s^2) needed before a drift is estimated: two samples 
+ *  DS1307_DRIFT_MIN_SPAN_S apart. With 1ms of sample jitter the slope error is then below ~2.5ppm - samples a 
+ *  second apart would give +-1000ppm.
+*/
+#define DS1307_DRIFT_MIN_SUM_XX		(((int64_t)DS1307_DRIFT_MIN_SPAN_S * DS1307_DRIFT_MIN_SPAN_S) / 2)
+
+void DS1307_Drift_Reset();
+uint8_t DS1307_Drift_AddSample(uint64_t rtcUs, uint64_t referenceUs);
+uint8_t DS1307_Drift_AddReference(uint64_t referenceUsSince2000);
+uint8_t DS1307_Drift_SampleLocalTimer();
+uint8_t DS1307_Drift_GetPpb(int32_t *driftPpb);
+uint32_t DS1307_Drift_SampleCount();
+void DS1307_Drift_SetAutoTrim(bool enabled);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DS1307_DRIFT_H */
@@ -0,0 +1,140 @@
+#ifndef DS1307_HAL_H
+#define DS1307_HAL_H
+
+/**
+ * Platform layer of the parts of the library that don't touch the RP2040 peripherals: the transaction layer
+ * (I2C_Transaction.c), the register-level DS1307 code with the BCD/date conversions (DS1307.c), the batch reads
+ * (DS1307_Batch.c), the NVRAM journal and cache (DS1307_Journal.c, DS1307_NVRAMCache.c), the software alarms
+ * (DS1307_Alarm.c) and the DS1307 model (DS1307_Mock.c).
+ *
+ * - RP2040 build: just the Pico SDK headers.
+ * - Host build (DS1307_HOST_BUILD = 1, see test/CMakeLists.txt): the few SDK types and time functions those files
+ *   use, on top of the POSIX monotonic clock. There is no I2C controller on the host - a bus only works with a
+ *   backend (I2C_Bus_SetBackend(), e.g. DS1307_Mock_Attach()), transfers on a bus without one fail with an
+ *   address NACK (test/I2C_HostController.c). The host tests are single-threaded: disabling the interrupts does 
+ *   nothing and there are no repeating timers (adding one fails).
+*/
+
+#ifndef DS1307_HOST_BUILD
+#define DS1307_HOST_BUILD 0
+#endif
+
+#if DS1307_HOST_BUILD
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct i2c_inst i2c_inst_t;	/* Never dereferenced on the host */
+#define i2c0 ((i2c_inst_t *)NULL)
+#define i2c1 ((i2c_inst_t *)NULL)
+#define PICO_DEFAULT_I2C_SDA_PIN 4
+#define PICO_DEFAULT_I2C_SCL_PIN 5
+
+typedef uint64_t absolute_time_t;	/* Microseconds of the monotonic clock */
+
+static inline uint64_t time_us_64(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return ((uint64_t)now.tv_sec * 1000000u) + ((uint64_t)now.tv_nsec / 1000u);
+}
+
+static inline uint32_t time_us_32(void)
+{
+	return (uint32_t)time_us_64();
+}
+
+static inline absolute_time_t get_absolute_time(void)
+{
+	return time_us_64();
+}
+
+static inline absolute_time_t make_timeout_time_us(uint64_t us)
+{
+	return time_us_64() + us;
+}
+
+static inline absolute_time_t make_timeout_time_ms(uint32_t ms)
+{
+	return time_us_64() + ((uint64_t)ms * 1000u);
+}
+
+static inline int64_t absolute_time_diff_us(absolute_time_t from, absolute_time_t to)
+{
+	return (int64_t)(to - from);
+}
+
+static inline bool time_reached(absolute_time_t t)
+{
+	return time_us_64() >= t;
+}
+
+static inline void sleep_us(uint64_t us)
+{
+	struct timespec duration = { .tv_sec = (time_t)(us / 1000000u), .tv_nsec = (long)((us % 1000000u) * 1000u) };
+
+	nanosleep(&duration, NULL);
+}
+
+static inline void sleep_ms(uint32_t ms)
+{
+	sleep_us((uint64_t)ms * 1000u);
+}
+
+static inline void tight_loop_contents(void)
+{
+}
+
+static inline uint32_t save_and_disable_interrupts(void)
+{
+	return 0;
+}
+
+static inline void restore_interrupts(uint32_t status)
+{
+	(void)status;
+}
+
+typedef struct repeating_timer repeating_timer_t;
+typedef bool (*repeating_timer_callback_t)(repeating_timer_t *rt);
+struct repeating_timer
+{
+	repeating_timer_callback_t callback;
+	void *user_data;
+};
+
+static inline bool add_repeating_timer_ms(int32_t delay_ms, repeating_timer_callback_t callback, void *user_data, repeating_timer_t *out)
+{
+	(void)delay_ms;
+	(void)callback;
+	(void)user_data;
+	(void)out;
+	return false;
+}
+
+static inline bool cancel_repeating_timer(repeating_timer_t *timer)
+{
+	(void)timer;
+	return false;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#else
+
+#include "pico/stdlib.h"
+#include "hardware/i2c.h"
+#include "hardware/sync.h"
+
+#endif /* DS1307_HOST_BUILD */
+
+#endif /* DS1307_HAL_H */
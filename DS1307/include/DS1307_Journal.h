@@ -0,0 +1,30 @@
+#ifndef DS1307_JOURNAL_H
+#define DS1307_JOURNAL_H
+
+#include "stdint.h"
+#include "stddef.h"
+#include "DS1307.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Slot layout: [sequence (1B)] [payload (25B)] [CRC16 (2B, big endian)] - two slots fill the whole NVRAM */
+#define DS1307_JOURNAL_SLOT_COUNT		2
+#define DS1307_JOURNAL_SLOT_SIZE		(DS1307_NVRAM_SIZE / DS1307_JOURNAL_SLOT_COUNT)
+#define DS1307_JOURNAL_HEADER_SIZE		1
+#define DS1307_JOURNAL_CRC_SIZE			2
+#define DS1307_JOURNAL_PAYLOAD_SIZE		(DS1307_JOURNAL_SLOT_SIZE - DS1307_JOURNAL_HEADER_SIZE - DS1307_JOURNAL_CRC_SIZE)
+#define DS1307_JOURNAL_CRC16_INIT		0xFFFF
+#define DS1307_JOURNAL_CRC16_POLY		0x1021 /* CRC-16/CCITT-FALSE */
+#define DS1307_JOURNAL_NO_RECORD		3 /* No valid slot found (first boot or NVRAM lost) - distinct from the I2C_Driver.h status codes */
+
+uint8_t DS1307_Journal_Recover(uint8_t *payload);
+uint8_t DS1307_Journal_Commit(const uint8_t *payload, size_t length);
+uint16_t DS1307_Journal_Crc16(const uint8_t *data, size_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DS1307_JOURNAL_H */
@@ -0,0 +1,84 @@
+#ifndef DS1307_LOG_H
+#define DS1307_LOG_H
+
+/**
+ * Leveled, compile-time filtered logging used by the whole library.
+ * 
+ * - DS1307_LOG_LEVEL selects what is compiled in. Everything above it expands to nothing, arguments included,
+ *   so e.g. a register read done only to be printed disappears as well. Use DS1307_LOG_LEVEL_NONE for 
+ *   production builds - no stdio at all on the read/write paths.
+ * - With DS1307_LOG_DEFERRED = 1 the macros don't call printf. They only store the format string pointer and up 
+ *   to DS1307_LOG_MAX_ARGS integer arguments in a ring buffer (a few stores) and DS1307_Log_Drain(), called e.g. in 
+ *   a loop on core 1, does the formatting and printing. Formats must be string literals and arguments integers.
+*/
+
+#include "stdint.h"
+#include "stddef.h"
+
+#define DS1307_LOG_LEVEL_NONE	0
+#define DS1307_LOG_LEVEL_ERROR	1
+#define DS1307_LOG_LEVEL_WARN	2
+#define DS1307_LOG_LEVEL_INFO	3
+#define DS1307_LOG_LEVEL_DEBUG	4
+
+#ifndef DS1307_LOG_LEVEL
+#define DS1307_LOG_LEVEL DS1307_LOG_LEVEL_ERROR
+#endif
+
+#ifndef DS1307_LOG_DEFERRED
+#define DS1307_LOG_DEFERRED 0
+#endif
+
+#define DS1307_LOG_MAX_ARGS			6
+#define DS1307_LOG_BUFFER_ENTRIES	32 /* Power of 2 */
+
+#if(DS1307_LOG_DEFERRED == 1)
+#ifdef __cplusplus
+extern "C" {
+#endif
+void DS1307_Log_Push(const char *format, const uint32_t *args, size_t argCount);
+uint32_t DS1307_Log_Drain();
+uint32_t DS1307_Log_DroppedCount();
+#ifdef __cplusplus
+}
+#endif
+/* The leading 0 keeps the initializer valid for calls without arguments */
+#define DS1307_LOG_OUTPUT(...) DS1307_LOG_OUTPUT_ARGS(__VA_ARGS__, )
+#define DS1307_LOG_OUTPUT_ARGS(format, ...) \
+	do { \
+		const uint32_t logArgs_au32[] = { 0, __VA_ARGS__ }; \
+		DS1307_Log_Push(format, &logArgs_au32[1], (sizeof(logArgs_au32) / sizeof(logArgs_au32[0])) - 1); \
+	} while(0)
+#else
+#include <stdio.h>
+#define DS1307_LOG_OUTPUT(...) printf(__VA_ARGS__)
+#endif
+
+#if(DS1307_LOG_LEVEL >= DS1307_LOG_LEVEL_ERROR)
+#define LOG_ERROR(...) DS1307_LOG_OUTPUT(__VA_ARGS__)
+#else
+#define LOG_ERROR(...)
+#endif
+
+#if(DS1307_LOG_LEVEL >= DS1307_LOG_LEVEL_WARN)
+#define LOG_WARN(...) DS1307_LOG_OUTPUT(__VA_ARGS__)
+#else
+#define LOG_WARN(...)
+#endif
+
+#if(DS1307_LOG_LEVEL >= DS1307_LOG_LEVEL_INFO)
+#define LOG_INFO(...) DS1307_LOG_OUTPUT(__VA_ARGS__)
+#else
+#define LOG_INFO(...)
+#endif
+
+#if(DS1307_LOG_LEVEL >= DS1307_LOG_LEVEL_DEBUG)
+#define LOG_DEBUG(...) DS1307_LOG_OUTPUT(__VA_ARGS__)
+#else
+#define LOG_DEBUG(...)
+#endif
+
+/* Kept for existing code */
+#define LOG(...) LOG_INFO(__VA_ARGS__)
+
+#endif /* DS1307_LOG_H */
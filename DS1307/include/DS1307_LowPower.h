@@ -0,0 +1,21 @@
+#ifndef DS1307_LOW_POWER_H
+#define DS1307_LOW_POWER_H
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "DS1307.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint8_t DS1307_LowPower_Start(I2C_Device_t *rtc, uint32_t sqwGpio);
+uint8_t DS1307_LowPower_WaitForTick(DS1307_DateTime_t *dateTime);
+uint8_t DS1307_LowPower_WaitForTickRaw(uint8_t *timekeeperRegs);
+void DS1307_LowPower_Stop();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DS1307_LOW_POWER_H */
@@ -0,0 +1,37 @@
+#ifndef DS1307_MOCK_H
+#define DS1307_MOCK_H
+
+#include "stdint.h"
+#include "stddef.h"
+#include "stdbool.h"
+#include "DS1307.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DS1307_MOCK_REGISTER_COUNT	64 /* 00h-3Fh, the register pointer wraps from 3Fh to 00h */
+#define DS1307_MOCK_CONTROL_WRITE_MASK (CONTROL_REG_OUT_BIT | CONTROL_REG_SQWE_BIT | CONTROL_REG_RS_MASK) /* Bits 2,3,5,6 read 0 */
+
+/* Emulated DS1307 - register file plus bus statistics */
+typedef struct
+{
+	uint8_t regs[DS1307_MOCK_REGISTER_COUNT];
+	uint8_t pointer;				/* Register pointer, auto-incremented by every byte read or written */
+	uint8_t address;				/* Slave address the mock answers to */
+	uint32_t failNextCount;			/* The next N transfers fail with an address NACK (error injection) */
+	uint32_t transactionCount;		/* Transfers seen (START to STOP) */
+	uint32_t bytesOnBus;			/* Address and data bytes of all transfers */
+} DS1307_Mock_t;
+
+void DS1307_Mock_Init(DS1307_Mock_t *mock);
+uint8_t DS1307_Mock_Transfer(void *context, uint8_t address, const uint8_t *txData, size_t txLength, uint8_t *rxData, size_t rxLength);
+void DS1307_Mock_Attach(DS1307_Mock_t *mock, I2C_Bus_t *bus);
+void DS1307_Mock_Tick(DS1307_Mock_t *mock, uint32_t seconds);
+void DS1307_Mock_ResetStats(DS1307_Mock_t *mock);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DS1307_MOCK_H */
@@ -0,0 +1,31 @@
+#ifndef DS1307_NVRAM_CACHE_H
+#define DS1307_NVRAM_CACHE_H
+
+#include "stdint.h"
+#include "stddef.h"
+#include "stdbool.h"
+#include "DS1307.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Clean gaps up to this many bytes between dirty runs are written too - cheaper than the ~3 byte overhead 
+ * (slave address + register pointer + START/STOP) of an extra transaction */
+#define DS1307_NVRAM_CACHE_MERGE_GAP	3
+
+uint8_t DS1307_NVRAMCache_Load();
+uint8_t DS1307_NVRAMCache_Read(uint8_t offset, uint8_t *buffer, size_t length);
+uint8_t DS1307_NVRAMCache_Write(uint8_t offset, const uint8_t *data, size_t length);
+uint8_t DS1307_NVRAMCache_Flush();
+bool DS1307_NVRAMCache_IsDirty();
+uint8_t DS1307_NVRAMCache_StartPeriodicFlush(int32_t intervalMs);
+void DS1307_NVRAMCache_StopPeriodicFlush();
+uint8_t DS1307_NVRAMCache_Service();
+uint8_t DS1307_NVRAMCache_PowerFailFlush();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DS1307_NVRAM_CACHE_H */
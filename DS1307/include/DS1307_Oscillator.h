@@ -0,0 +1,29 @@
+#ifndef DS1307_OSCILLATOR_H
+#define DS1307_OSCILLATOR_H
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "DS1307.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DS1307_OSC_READY_TIMEOUT_MS		3000 /* Default - crystal start-up plus up to 1s until the seconds change */
+#define DS1307_OSC_POLL_INTERVAL_MS		10   /* Seconds register polling period (polling mode) */
+#define DS1307_OSC_SQW_EDGES			8    /* Latched SQW edges that count as "running" (at most 2 per Service() call) */
+#define DS1307_OSC_SQW_NOT_USED			0xFFFFFFFFu /* sqwGpio value - detect by polling the seconds register */
+
+/* Called from DS1307_Oscillator_Service() - STATUS_SUCCESS or STAUS_FAILURE (timeout/I2C error) */
+typedef void (*DS1307_OscReadyCallback_t)(uint8_t status, void *context);
+
+uint8_t DS1307_Dev_StartOscillatorAsync(I2C_Device_t *rtc, uint32_t sqwGpio, uint32_t timeoutMs, 
+										DS1307_OscReadyCallback_t callback, void *context);
+uint8_t DS1307_Oscillator_Service();
+uint8_t DS1307_Dev_WaitOscillatorReady(I2C_Device_t *rtc, uint32_t sqwGpio, uint32_t timeoutMs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DS1307_OSCILLATOR_H */
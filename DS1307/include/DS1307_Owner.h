@@ -0,0 +1,25 @@
+#ifndef DS1307_OWNER_H
+#define DS1307_OWNER_H
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "DS1307.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DS1307_OWNER_DEFAULT_REFRESH_MS		100
+
+uint8_t DS1307_Owner_LaunchCore1(uint32_t refreshIntervalMs);
+void DS1307_Owner_Core1Loop();
+uint8_t DS1307_Owner_StartIrq(uint32_t refreshIntervalMs);
+void DS1307_Owner_StopIrq();
+uint8_t DS1307_Owner_GetDateTime(DS1307_DateTime_t *dateTime);
+uint32_t DS1307_Owner_GetPublishCount();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DS1307_OWNER_H */
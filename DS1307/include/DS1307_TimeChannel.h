@@ -0,0 +1,60 @@
+#ifndef DS1307_TIME_CHANNEL_H
+#define DS1307_TIME_CHANNEL_H
+
+/**
+ * Lock-free single-writer / multi-reader publication of a date/time (seqlock).
+ * 
+ * The writer makes the sequence odd, updates the value and makes the sequence even again. Readers copy the value 
+ * and retry if the sequence was odd or changed meanwhile. Readers never block the writer and never take a lock, 
+ * so it works from both cores and from interrupts. There must be only one writer (one core/IRQ).
+*/
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "hardware/sync.h"
+#include "DS1307.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct
+{
+	volatile uint32_t sequence;
+	DS1307_DateTime_t dateTime;		/* Not volatile (a volatile struct can't be copied in C++) - __dmb() orders it */
+	volatile uint32_t publishCount;	/* Number of publications so far (0 - never published) */
+} DS1307_TimeChannel_t;
+
+static inline void DS1307_TimeChannel_Publish(DS1307_TimeChannel_t *channel, const DS1307_DateTime_t *dateTime)
+{
+	channel->sequence++;
+	__dmb();
+	channel->dateTime = *dateTime;
+	channel->publishCount++;
+	__dmb();
+	channel->sequence++;
+}
+
+/* Returns the publish count of the copied value - 0 if nothing was published yet */
+static inline uint32_t DS1307_TimeChannel_Read(const DS1307_TimeChannel_t *channel, DS1307_DateTime_t *dateTime)
+{
+	uint32_t sequence;
+	uint32_t publishCount;
+
+	do
+	{
+		sequence = channel->sequence;
+		__dmb();
+		*dateTime = channel->dateTime;
+		publishCount = channel->publishCount;
+		__dmb();
+	} while((sequence & 1) || (sequence != channel->sequence));
+
+	return publishCount;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DS1307_TIME_CHANNEL_H */
@@ -0,0 +1,27 @@
+#ifndef I2C_DMA_H
+#define I2C_DMA_H
+
+#include "stdint.h"
+#include "stddef.h"
+#include "stdbool.h"
+#include "I2C_Driver.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define I2C_DMA_TX_FIFO_THRESHOLD	4 /* TX DREQ is asserted while there are <= 4 entries in the TX FIFO */
+#define I2C_DMA_RX_FIFO_THRESHOLD	0 /* RX DREQ is asserted as soon as there is 1 entry in the RX FIFO */
+
+uint8_t I2C_DMA_Initialize(I2C_Bus_t *bus);
+uint8_t I2C_DMA_Read_Async(I2C_Device_t *device, uint8_t startRegisterAddress, uint8_t *buffer, size_t length, I2C_TransferCallback_t callback, void *context);
+uint8_t I2C_DMA_Write_Async(I2C_Device_t *device, uint8_t startRegisterAddress, const uint8_t *data, size_t length, I2C_TransferCallback_t callback, void *context);
+bool I2C_DMA_IsBusy(const I2C_Bus_t *bus);
+uint8_t I2C_DMA_GetStatus(const I2C_Bus_t *bus);
+uint8_t I2C_DMA_Cancel(I2C_Bus_t *bus, void *context);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* I2C_DMA_H */
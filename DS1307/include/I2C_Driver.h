@@ -2,20 +2,169 @@
 #define I2C_DRIVER_H
 
 #include "stdint.h"
+#include "stddef.h"
+#include "DS1307_HAL.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
 
 #define I2C0_REGISTER_STRUCTURE ((i2c_hw_t *)I2C0_BASE)
 #define RESET_CONTROL_REGISTER_STRUCTURE ((resets_hw_t *)RESETS_BASE)
+#define I2C_STANDARD_MODE 100000 /* 100kHz */
 #define I2C_FAST_MODE 400000 /* 400kHz */
+#define I2C_FAST_MODE_PLUS 1000000 /* 1MHz */
+#define I2C_CONTROLLER_COUNT 2 /* I2C0 and I2C1 - size of the per-controller state of the DMA/IRQ/scheduler modules */
 #define CLK_SYS_88NS_IN_CYCLES 11
 #define DS1307_I2C_ADDRESS (0x68)
 #define STATUS_SUCCESS						 0
 #define STAUS_FAILURE                        1
+#define STATUS_BUSY                          2 /* An asynchronous transfer is still in progress */
 #define MPU6050_REGISTER_I2C_READ_FAIL		 ((uint8_t)0xFF)
+#define I2C_BURST_MAX_LENGTH				 64 /* Whole DS1307 register map (00h-3Fh) */
 #define MPU6050_SENSOR_DATA_READ_FAIL		 ((uint32_t)0xDEADBEEF)
 
+/* Controller timing for one bus speed - computed by I2C_ComputeTiming() for the current clk_sys */
+typedef struct
+{
+	uint32_t speedMode;	/* IC_CON.SPEED value */
+	uint32_t hcnt;		/* SCL high count (clk_sys cycles) */
+	uint32_t lcnt;		/* SCL low count (clk_sys cycles) */
+	uint32_t spklen;	/* Spike suppression limit (clk_sys cycles) */
+	uint32_t sdaHold;	/* SDA TX hold time (clk_sys cycles) */
+} I2C_Timing_t;
+
+/* Detailed transaction errors - see I2C_GetLastError() */
+#define I2C_ERROR_NONE				0
+#define I2C_ERROR_ADDRESS_NACK		1 /* No slave acknowledged the address (missing/busy device) */
+#define I2C_ERROR_DATA_NACK			2 /* Slave didn't acknowledge a data byte */
+#define I2C_ERROR_ARBITRATION_LOST	3 /* Another master won the bus */
+#define I2C_ERROR_ABORT_OTHER		4 /* Any other IC_TX_ABRT_SOURCE reason */
+#define I2C_ERROR_TIMEOUT			5 /* Transfer didn't finish before its deadline (bus stuck) */
+
+/* Bounds of the blocking transactions - total time spent on a dead device is ~totalBudgetUs at most */
+typedef struct
+{
+	uint32_t maxRetries;			/* Retries after the first attempt */
+	uint32_t initialBackoffUs;		/* Delay before the first retry, doubled for every next one */
+	uint32_t maxBackoffUs;			/* Upper limit of the retry delay */
+	uint32_t attemptTimeoutBaseUs;	/* Deadline of one attempt = base + perByte * bytes on the bus */
+	uint32_t perByteTimeoutUs;
+	uint32_t totalBudgetUs;			/* No new retry is started after this time */
+} I2C_RetryPolicy_t;
+
+#define I2C_DEFAULT_RETRY_POLICY { .maxRetries = 5, .initialBackoffUs = 5, .maxBackoffUs = 1000, \
+								   .attemptTimeoutBaseUs = 500, .perByteTimeoutUs = 200, .totalBudgetUs = 20000 }
+
+/** Optional instrumentation of the blocking transaction layer (I2C_Dev_Transaction()) - DS1307_I2C_STATS = 1.
+ *  With 0 the counters, the I2C_Bus_t field and the time_us_32() calls are compiled out and I2C_Bus_GetStats() 
+ *  returns zeros. Latency is measured per transaction, retries and backoff included.
+*/
+#ifndef DS1307_I2C_STATS
+#define DS1307_I2C_STATS 0
+#endif
+
+#define I2C_STATS_ERROR_CODES		6 /* I2C_ERROR_NONE ... I2C_ERROR_TIMEOUT */
+#define I2C_STATS_HISTOGRAM_BINS	8 /* Latency bins: <64us, <128us, <256us ... <4096us, >=4096us */
+#define I2C_STATS_HISTOGRAM_FIRST_US_LOG2 6
+
+typedef struct
+{
+	uint32_t transactions;
+	uint32_t failedTransactions;			/* Failed after all retries */
+	uint32_t retries;
+	uint32_t bytesWritten;					/* Data bytes of successful transactions (register pointer included) */
+	uint32_t bytesRead;
+	uint32_t errors[I2C_STATS_ERROR_CODES];	/* Failed attempts per I2C_ERROR_ code */
+	uint32_t latencyMinUs;
+	uint32_t latencyMaxUs;
+	uint64_t latencyTotalUs;				/* Average = latencyTotalUs / transactions */
+	uint32_t latencyHistogram[I2C_STATS_HISTOGRAM_BINS];
+} I2C_Stats_t;
+
+/** Transfer backend of a bus - replaces the controller for the blocking transaction layer (see I2C_Bus_SetBackend()).
+ *  Does one attempt: write txData, then read rxLength bytes with a repeated START. Returns an I2C_ERROR_ code.
+*/
+typedef uint8_t (*I2C_BackendTransfer_t)(void *context, uint8_t address, const uint8_t *txData, size_t txLength, 
+										 uint8_t *rxData, size_t rxLength);
+
+/* One I2C controller with its pins - see I2C_Bus_Init() */
+typedef struct
+{
+	i2c_inst_t *instance;			/* i2c0 or i2c1 */
+	uint32_t sdaPin;
+	uint32_t sclPin;
+	uint32_t baudrate;				/* Default speed of the bus */
+	I2C_Timing_t timing;			/* Timing for 'baudrate' */
+	const I2C_Timing_t *activeTiming; /* Timing currently programmed in the controller */
+	I2C_RetryPolicy_t retryPolicy;
+	uint8_t lastError;
+	uint32_t lastAbortSource;
+	I2C_BackendTransfer_t backend;	/* NULL - the RP2040 controller */
+	void *backendContext;
+#if DS1307_I2C_STATS
+	I2C_Stats_t stats;
+#endif
+} I2C_Bus_t;
+
+/* One slave on a bus - see I2C_Device_Init() */
+typedef struct
+{
+	I2C_Bus_t *bus;
+	uint8_t address;
+	I2C_Timing_t timing;			/* Speed of this device (hcnt = 0 - bus speed) */
+} I2C_Device_t;
+
+#define I2C_BUS_DEFAULT_INITIALIZER { .instance = i2c0, .sdaPin = PICO_DEFAULT_I2C_SDA_PIN, .sclPin = PICO_DEFAULT_I2C_SCL_PIN, \
+									  .baudrate = I2C_FAST_MODE, .timing = { 0 }, .activeTiming = NULL, \
+									  .retryPolicy = I2C_DEFAULT_RETRY_POLICY, .lastError = I2C_ERROR_NONE, .lastAbortSource = 0, \
+									  .backend = NULL, .backendContext = NULL }
+
+/* I2C0 on the default pins and the DS1307 on it - used by the functions without a bus/device parameter */
+extern I2C_Bus_t I2C_DefaultBus;
+extern I2C_Device_t I2C_DefaultDevice;
+
+/* Completion callback of the asynchronous (DMA/IRQ) transfers, called from interrupt context */
+typedef void (*I2C_TransferCallback_t)(uint8_t status, void *context);
+
+void I2C_Bus_Init(I2C_Bus_t *bus, i2c_inst_t *instance, uint32_t sdaPin, uint32_t sclPin, uint32_t baudrate);
+void I2C_Bus_Reset(I2C_Bus_t *bus);
+void I2C_Bus_Suspend(I2C_Bus_t *bus);
+void I2C_Bus_Resume(I2C_Bus_t *bus);
+void I2C_Bus_ApplyTiming(I2C_Bus_t *bus, const I2C_Timing_t *timing);
+void I2C_Bus_SetRetryPolicy(I2C_Bus_t *bus, const I2C_RetryPolicy_t *policy);
+uint8_t I2C_Bus_GetLastError(const I2C_Bus_t *bus, uint32_t *abortSource);
+void I2C_Bus_Recovery(I2C_Bus_t *bus);
+void I2C_Bus_AbortTransfer(I2C_Bus_t *bus);
+bool I2C_Bus_CompleteAbort(I2C_Bus_t *bus);
+void I2C_Bus_SetBackend(I2C_Bus_t *bus, I2C_BackendTransfer_t backend, void *context);
+void I2C_Bus_GetStats(const I2C_Bus_t *bus, I2C_Stats_t *stats);
+void I2C_Bus_ResetStats(I2C_Bus_t *bus);
+void I2C_Device_Init(I2C_Device_t *device, I2C_Bus_t *bus, uint8_t address, uint32_t baudrate);
+void I2C_Dev_Select(I2C_Device_t *device);
+uint8_t I2C_Dev_Transaction(I2C_Device_t *device, const uint8_t *txData, size_t txLength, uint8_t *rxData, size_t rxLength);
+uint8_t I2C_Bus_TransferAttempt(I2C_Bus_t *bus, const uint8_t *txData, size_t txLength, uint8_t *rxData, size_t rxLength);
+uint8_t I2C_Dev_Register_Read(I2C_Device_t *device, uint8_t registerAddress);
+uint8_t I2C_Dev_Register_Write(I2C_Device_t *device, uint8_t registerAddress, uint8_t registerValue);
+uint8_t I2C_Dev_Burst_Read(I2C_Device_t *device, uint8_t startRegisterAddress, uint8_t *buffer, size_t length);
+uint8_t I2C_Dev_Burst_Write(I2C_Device_t *device, uint8_t startRegisterAddress, const uint8_t *data, size_t length);
+
+uint8_t I2C_Transaction(uint8_t slaveAddress, const uint8_t *txData, size_t txLength, uint8_t *rxData, size_t rxLength);
+void I2C_SetRetryPolicy(const I2C_RetryPolicy_t *policy);
+uint8_t I2C_GetLastError(uint32_t *abortSource);
+void I2C_BusRecovery();
 uint8_t I2C_Register_Read(uint8_t registerAddress);
 uint8_t I2C_Register_Write(uint8_t registerAddress, uint8_t registerValue);
+uint8_t I2C_Burst_Read(uint8_t startRegisterAddress, uint8_t *buffer, size_t length);
+uint8_t I2C_Burst_Write(uint8_t startRegisterAddress, const uint8_t *data, size_t length);
 void I2C_Initialize(uint32_t baudrate);
+void I2C_ComputeTiming(uint32_t baudrate, I2C_Timing_t *timing);
+void I2C_ApplyTiming(const I2C_Timing_t *timing);
+void I2C_SetBaudrate(uint32_t baudrate);
 void Reset_I2C0();
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* I2C_DRIVER_H */
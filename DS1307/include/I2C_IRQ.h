@@ -0,0 +1,41 @@
+#ifndef I2C_IRQ_H
+#define I2C_IRQ_H
+
+#include "stdint.h"
+#include "stddef.h"
+#include "stdbool.h"
+#include "I2C_Driver.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define I2C_IRQ_QUEUE_SIZE			8  /* Max number of outstanding transfers (power of 2) */
+#define I2C_IRQ_FIFO_DEPTH			16 /* Both TX and RX FIFOs of the DW_apb_i2c are 16 entries deep */
+#define I2C_IRQ_TX_FIFO_THRESHOLD	4  /* TX_EMPTY fires when there are <= 4 entries left in the TX FIFO */
+#define I2C_IRQ_RX_FIFO_THRESHOLD	0  /* RX_FULL fires as soon as there is 1 entry in the RX FIFO */
+#define I2C_TRANSFER_WRITE			false
+#define I2C_TRANSFER_READ			true
+
+/* Descriptor of one register burst read/write. Buffer must stay valid until the callback is called */
+typedef struct
+{
+	bool isRead;
+	I2C_Device_t *device;			/* Slave (and with it the bus) of the transfer */
+	uint8_t startRegisterAddress;
+	uint8_t *buffer;
+	size_t length;
+	I2C_TransferCallback_t callback;
+	void *context;
+} I2C_Transfer_t;
+
+uint8_t I2C_IRQ_Initialize(I2C_Bus_t *bus);
+uint8_t I2C_IRQ_Submit(const I2C_Transfer_t *transfer);
+uint32_t I2C_IRQ_PendingCount(const I2C_Bus_t *bus);
+uint8_t I2C_IRQ_Cancel(I2C_Bus_t *bus, void *context);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* I2C_IRQ_H */
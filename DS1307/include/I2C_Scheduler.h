@@ -0,0 +1,29 @@
+#ifndef I2C_SCHEDULER_H
+#define I2C_SCHEDULER_H
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "I2C_Driver.h"
+#include "I2C_IRQ.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define I2C_SCHED_PRIORITY_CRITICAL		0 /* Latency-critical (e.g. sensor reads) - never split */
+#define I2C_SCHED_PRIORITY_HIGH			1
+#define I2C_SCHED_PRIORITY_NORMAL		2
+#define I2C_SCHED_PRIORITY_LOW			3 /* Bulk traffic (e.g. RTC/NVRAM bursts) */
+#define I2C_SCHED_PRIORITY_LEVELS		4
+#define I2C_SCHED_QUEUE_SIZE			8 /* Per priority level */
+#define I2C_SCHED_MAX_CHUNK				8 /* Non-critical reads are split into chunks of max 8 bytes (writes never) */
+
+uint8_t I2C_Scheduler_Init(I2C_Bus_t *bus);
+uint8_t I2C_Scheduler_Submit(const I2C_Transfer_t *transfer, uint8_t priority);
+uint32_t I2C_Scheduler_PendingCount(const I2C_Bus_t *bus);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* I2C_SCHEDULER_H */
@@ -0,0 +1,219 @@
+/**
+ * Host benchmark of the DS1307 library - the driver runs against the DS1307 model (DS1307_Mock.c), so the bus cost
+ * of every access path is exact and reproducible. Prints CSV, one line per measurement:
+ *
+ *   BUS,<name>,<iterations>,<failures>,<transactions_per_op>,<bytes_per_op>
+ *   CONV,<name>,<iterations>,<ns_per_op>
+ *
+ * "BENCH,END" marks the end of the run. Usage: DS1307_HOST_BENCHMARK [iterations]
+ * Bytes count the address bytes (one per START / repeated START) and the data bytes, i.e. ~9 SCL clocks each.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "DS1307.h"
+#include "DS1307_Batch.h"
+#include "DS1307_Mock.h"
+#include "I2C_Driver.h"
+
+#define BENCH_DEFAULT_ITERATIONS	100000
+#define BENCH_NVRAM_TEST_OFFSET		48 /* Last 8 bytes of the NVRAM - same as the on-device benchmark */
+#define BENCH_NVRAM_TEST_LENGTH		8
+
+typedef uint8_t (*BenchFunction_t)(void);
+
+static I2C_Bus_t benchBus = I2C_BUS_DEFAULT_INITIALIZER;
+static I2C_Device_t benchRtc = { .bus = &benchBus, .address = DS1307_I2C_ADDRESS, .timing = { 0 } };
+static DS1307_Mock_t mock;
+static uint32_t iterations = BENCH_DEFAULT_ITERATIONS;
+
+static uint8_t timekeeperRegs_au8[DS1307_TIMEKEEPER_REGS_LENGTH];
+static uint8_t nvram_au8[BENCH_NVRAM_TEST_LENGTH];
+static DS1307_DateTime_t dateTime;
+static volatile uint32_t sink; /* Keeps the conversion results alive */
+
+static uint64_t Bench_NowNs(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return ((uint64_t)now.tv_sec * 1000000000u) + (uint64_t)now.tv_nsec;
+}
+
+/* Bus cost - the mock counters divided by the iterations (the shadow is loaded before, as after boot) */
+static void Bench_Bus(const char *name, BenchFunction_t function)
+{
+	uint32_t failures = 0;
+
+	DS1307_Mock_Init(&mock);
+	DS1307_Mock_Attach(&mock, &benchBus);
+	DS1307_Dev_InvalidateShadow(&benchRtc);
+	DS1307_Dev_EnableOscillator(&benchRtc);
+	DS1307_Dev_LoadShadow(&benchRtc);
+	DS1307_Mock_ResetStats(&mock);
+
+	for(uint32_t i = 0; i < iterations; i++)
+	{
+		if(function() != STATUS_SUCCESS)
+		{
+			failures++;
+		}
+	}
+
+	printf("BUS,%s,%lu,%lu,%.2f,%.2f\n", name, (unsigned long)iterations, (unsigned long)failures,
+		   (double)mock.transactionCount / iterations, (double)mock.bytesOnBus / iterations);
+}
+
+static void Bench_Conversion(const char *name, BenchFunction_t function)
+{
+	uint64_t startNs = Bench_NowNs();
+
+	for(uint32_t i = 0; i < iterations; i++)
+	{
+		function();
+	}
+
+	printf("CONV,%s,%lu,%.1f\n", name, (unsigned long)iterations, (double)(Bench_NowNs() - startNs) / iterations);
+}
+
+/* Timekeeper block register by register - the old way of reading the time */
+static uint8_t Bench_SingleRegisterReads(void)
+{
+	for(uint8_t reg = 0; reg < DS1307_TIMEKEEPER_REGS_LENGTH; reg++)
+	{
+		timekeeperRegs_au8[reg] = I2C_Dev_Register_Read(&benchRtc, reg);
+		if(I2C_Bus_GetLastError(&benchBus, NULL) != I2C_ERROR_NONE)
+		{
+			return STAUS_FAILURE;
+		}
+	}
+	return STATUS_SUCCESS;
+}
+
+static uint8_t Bench_ReadDateTime(void)
+{
+	return DS1307_Dev_ReadDateTime(&benchRtc, &dateTime);
+}
+
+static uint8_t Bench_ReadTimestamp(void)
+{
+	DS1307_Timestamp_t timestamp;
+
+	return DS1307_Dev_ReadTimestamp(&benchRtc, &timestamp);
+}
+
+static uint8_t Bench_WriteDateTime(void)
+{
+	const DS1307_DateTime_t newDateTime = { .seconds = 0, .minutes = 30, .hours = 12, .dayOfWeek = 3, .date = 15, .month = 6, .year = 26 };
+
+	return DS1307_Dev_WriteDateTime(&benchRtc, &newDateTime);
+}
+
+static uint8_t Bench_NVRAMRead(void)
+{
+	return DS1307_Dev_NVRAM_Read(&benchRtc, BENCH_NVRAM_TEST_OFFSET, nvram_au8, sizeof(nvram_au8));
+}
+
+static uint8_t Bench_NVRAMWrite(void)
+{
+	return DS1307_Dev_NVRAM_Write(&benchRtc, BENCH_NVRAM_TEST_OFFSET, nvram_au8, sizeof(nvram_au8));
+}
+
+/* Time plus the last NVRAM bytes - one read wrapping past 3Fh vs. two reads */
+static uint8_t Bench_DateTimeAndNVRAM(void)
+{
+	return DS1307_Dev_ReadDateTimeAndNVRAM(&benchRtc, &dateTime, BENCH_NVRAM_TEST_OFFSET, nvram_au8, sizeof(nvram_au8));
+}
+
+static uint8_t Bench_DateTimeThenNVRAM(void)
+{
+	uint8_t status = DS1307_Dev_ReadDateTime(&benchRtc, &dateTime);
+
+	return (status == STATUS_SUCCESS) ? Bench_NVRAMRead() : status;
+}
+
+/* Shadowed control register - rewriting the current value and changing OUT */
+static uint8_t Bench_SetControlUnchanged(void)
+{
+	return DS1307_Dev_SetControl(&benchRtc, CONTROL_REG_RS_32768HZ);
+}
+
+static uint8_t Bench_SetOutputLevel(void)
+{
+	static bool high = false;
+
+	high = !high;
+	return DS1307_Dev_SetOutputLevel(&benchRtc, high);
+}
+
+/* Conversions - the input walks the whole calendar so no branch is always taken */
+static uint32_t conversionInput = 0;
+
+static uint8_t Bench_FromSecondsSince2000(void)
+{
+	conversionInput = (conversionInput + 86413u) % 3155760000u;
+	DS1307_FromSecondsSince2000(conversionInput, &dateTime);
+	sink += dateTime.date;
+	return STATUS_SUCCESS;
+}
+
+static uint8_t Bench_ToSecondsSince2000(void)
+{
+	sink += DS1307_ToSecondsSince2000(&dateTime);
+	dateTime.date = (uint8_t)((dateTime.date % 28) + 1);
+	return STATUS_SUCCESS;
+}
+
+static uint8_t Bench_TimestampFromRegs(void)
+{
+	sink += DS1307_TimestampFromRegs(timekeeperRegs_au8);
+	timekeeperRegs_au8[0] = (uint8_t)((timekeeperRegs_au8[0] + 1) & 0x3F);
+	return STATUS_SUCCESS;
+}
+
+static uint8_t Bench_DecodeDateTimeValidated(void)
+{
+	uint8_t status = DS1307_DecodeDateTimeValidated(timekeeperRegs_au8, &dateTime);
+
+	sink += status + dateTime.seconds;
+	timekeeperRegs_au8[0] = (uint8_t)((timekeeperRegs_au8[0] + 1) & 0x3F);
+	return status;
+}
+
+static uint8_t Bench_BcdRoundTrip(void)
+{
+	sink += DS1307_BcdToDec(DS1307_DecToBcd((uint8_t)(sink % 100)));
+	return STATUS_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+	if(argc > 1)
+	{
+		iterations = (uint32_t)strtoul(argv[1], NULL, 10);
+		iterations = (iterations == 0) ? 1 : iterations;
+	}
+
+	printf("# DS1307 host benchmark, %lu iterations\n", (unsigned long)iterations);
+	Bench_Bus("SingleRegisterReads", Bench_SingleRegisterReads);
+	Bench_Bus("ReadDateTime", Bench_ReadDateTime);
+	Bench_Bus("ReadTimestamp", Bench_ReadTimestamp);
+	Bench_Bus("WriteDateTime", Bench_WriteDateTime);
+	Bench_Bus("NVRAMRead8", Bench_NVRAMRead);
+	Bench_Bus("NVRAMWrite8", Bench_NVRAMWrite);
+	Bench_Bus("DateTimeAndNVRAM8", Bench_DateTimeAndNVRAM);
+	Bench_Bus("DateTimeThenNVRAM8", Bench_DateTimeThenNVRAM);
+	Bench_Bus("SetControlUnchanged", Bench_SetControlUnchanged);
+	Bench_Bus("SetOutputLevel", Bench_SetOutputLevel);
+
+	DS1307_FromSecondsSince2000(0, &dateTime);
+	DS1307_TimestampToRegs(0, timekeeperRegs_au8);
+	Bench_Conversion("FromSecondsSince2000", Bench_FromSecondsSince2000);
+	Bench_Conversion("ToSecondsSince2000", Bench_ToSecondsSince2000);
+	Bench_Conversion("TimestampFromRegs", Bench_TimestampFromRegs);
+	Bench_Conversion("DecodeDateTimeValidated", Bench_DecodeDateTimeValidated);
+	Bench_Conversion("BcdRoundTrip", Bench_BcdRoundTrip);
+	printf("BENCH,END\n");
+	return 0;
+}
@@ -0,0 +1,20 @@
+/**
+ * Cached clock (DS1307_Clock.c) for the host build - there is no SQW interrupt on a PC. Stands in for the
+ * functions the software alarms (DS1307_Alarm.c) call: the hook is only stored and the clock stands at
+ * 2000-01-01 00:00:00. The tests drive the alarms with DS1307_Alarm_Tick() directly.
+*/
+
+#include "DS1307_HAL.h"
+#include "DS1307_Clock.h"
+
+static DS1307_ClockTickHook_t tickHook = NULL;
+
+void DS1307_Clock_SetTickHook(DS1307_ClockTickHook_t hook)
+{
+	tickHook = hook;
+}
+
+uint32_t DS1307_Clock_GetSeconds()
+{
+	return 0;
+}
@@ -0,0 +1,599 @@
+/**
+ * Host unit tests of the DS1307 library - the driver runs unchanged on top of the transaction layer, with the bus
+ * routed to the DS1307 model (DS1307_Mock.c). Exit code 0 - all checks passed.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include "DS1307.h"
+#include "DS1307_Alarm.h"
+#include "DS1307_Batch.h"
+#include "DS1307_Journal.h"
+#include "DS1307_Mock.h"
+#include "DS1307_NVRAMCache.h"
+#include "I2C_Driver.h"
+
+static uint32_t checkCount = 0;
+static uint32_t failureCount = 0;
+
+#define CHECK(condition) \
+	do { \
+		checkCount++; \
+		if(!(condition)) \
+		{ \
+			failureCount++; \
+			printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+		} \
+	} while(0)
+
+#define CHECK_EQUAL(actual, expected) \
+	do { \
+		unsigned long actualValue = (unsigned long)(actual); \
+		unsigned long expectedValue = (unsigned long)(expected); \
+		checkCount++; \
+		if(actualValue != expectedValue) \
+		{ \
+			failureCount++; \
+			printf("FAIL %s:%d: %s = %lu, expected %lu\n", __FILE__, __LINE__, #actual, actualValue, expectedValue); \
+		} \
+	} while(0)
+
+/* One bus and RTC for all tests - the register shadow of DS1307.c is kept per bus */
+static I2C_Bus_t testBus = I2C_BUS_DEFAULT_INITIALIZER;
+static I2C_Device_t testRtc = { .bus = &testBus, .address = DS1307_I2C_ADDRESS, .timing = { 0 } };
+static DS1307_Mock_t mock;
+
+/** Fresh (power-up) DS1307, default retry policy, no backoff delays. The default bus (used by the modules without 
+ *  a device argument - journal, NVRAM cache) is routed to the same model.
+*/
+static void Test_Setup(void)
+{
+	const I2C_RetryPolicy_t policy = { .maxRetries = 5, .initialBackoffUs = 0, .maxBackoffUs = 0,
+									   .attemptTimeoutBaseUs = 500, .perByteTimeoutUs = 200, .totalBudgetUs = 20000 };
+
+	DS1307_Mock_Init(&mock);
+	DS1307_Mock_Attach(&mock, &testBus);
+	DS1307_Mock_Attach(&mock, &I2C_DefaultBus);
+	I2C_Bus_SetRetryPolicy(&testBus, &policy);
+	I2C_Bus_SetRetryPolicy(&I2C_DefaultBus, &policy);
+	I2C_Bus_ResetStats(&testBus);
+	I2C_Bus_ResetStats(&I2C_DefaultBus);
+	DS1307_Dev_InvalidateShadow(&testRtc);
+	DS1307_Dev_InvalidateShadow(&I2C_DefaultDevice);
+}
+
+static void Test_Bcd(void)
+{
+	for(uint8_t dec = 0; dec < 100; dec++)
+	{
+		CHECK_EQUAL(DS1307_DecToBcd(dec), DS1307_DEC_TO_BCD_CONST(dec));
+		CHECK_EQUAL(DS1307_BcdToDec(DS1307_DecToBcd(dec)), dec);
+		CHECK_EQUAL(ConvertBCD(ConvertBCD(dec, DEC_TO_BCD), BCD_TO_DEC), dec);
+	}
+	CHECK_EQUAL(DS1307_DecToBcd(59), 0x59);
+}
+
+static void Test_Hours(void)
+{
+	for(uint8_t hours24 = 0; hours24 < 24; hours24++)
+	{
+		uint8_t regs24[DS1307_TIMEKEEPER_REGS_LENGTH] = { 0 };
+		uint8_t regs12[DS1307_TIMEKEEPER_REGS_LENGTH] = { 0 };
+
+		regs24[2] = DS1307_DecToBcd(hours24);
+		regs12[2] = DS1307_EncodeHours12(hours24);
+		CHECK_EQUAL(DS1307_Reg_Hours24(regs24), hours24);
+		CHECK_EQUAL(DS1307_Reg_Hours24(regs12), hours24);
+		CHECK_EQUAL(DS1307_Reg_IsPM(regs12), hours24 >= 12);
+	}
+	CHECK_EQUAL(DS1307_EncodeHours12(0), HOURS_12H_MODE_BIT | 0x12);			/* 12 AM */
+	CHECK_EQUAL(DS1307_EncodeHours12(13), HOURS_12H_MODE_BIT | HOURS_12H_PM_BIT | 0x01);
+}
+
+static void Test_DecodeValidated(void)
+{
+	const uint8_t valid[DS1307_TIMEKEEPER_REGS_LENGTH] = { 0x59, 0x59, 0x23, 0x07, 0x29, 0x02, 0x24 };
+	uint8_t regs[DS1307_TIMEKEEPER_REGS_LENGTH];
+	DS1307_DateTime_t dateTime;
+
+	CHECK_EQUAL(DS1307_DecodeDateTimeValidated(valid, &dateTime), STATUS_SUCCESS);
+	CHECK_EQUAL(dateTime.hours, 23);
+	CHECK_EQUAL(dateTime.date, 29);
+
+	memcpy(regs, valid, sizeof(regs));
+	regs[1] = 0x5A; /* Not a BCD digit */
+	CHECK_EQUAL(DS1307_DecodeDateTimeValidated(regs, &dateTime), STAUS_FAILURE);
+
+	memcpy(regs, valid, sizeof(regs));
+	regs[6] = 0x23; /* 2023-02-29 doesn't exist */
+	CHECK_EQUAL(DS1307_DecodeDateTimeValidated(regs, &dateTime), STAUS_FAILURE);
+
+	memcpy(regs, valid, sizeof(regs));
+	regs[2] = HOURS_12H_MODE_BIT | 0x13; /* Hour 13 in 12-hour mode */
+	CHECK_EQUAL(DS1307_DecodeDateTimeValidated(regs, &dateTime), STAUS_FAILURE);
+}
+
+static void Test_DateConversion(void)
+{
+	DS1307_DateTime_t dateTime;
+	const DS1307_DateTime_t leapDay = { .seconds = 7, .minutes = 6, .hours = 5, .dayOfWeek = 5, .date = 29, .month = 2, .year = 24 };
+
+	DS1307_FromSecondsSince2000(0, &dateTime);
+	CHECK((dateTime.year == 0) && (dateTime.month == 1) && (dateTime.date == 1) && (dateTime.hours == 0));
+	CHECK_EQUAL(dateTime.dayOfWeek, 7); /* 2000-01-01 was a Saturday */
+
+	CHECK_EQUAL(DS1307_ToEpoch(&leapDay), 1709183167u); /* 2024-02-29 05:06:07 UTC */
+	CHECK_EQUAL(DS1307_DayOfWeek(24, 2, 29), 5);		  /* Thursday */
+	CHECK_EQUAL(DS1307_FromEpoch(1709183167u, &dateTime), STATUS_SUCCESS);
+	CHECK(memcmp(&dateTime, &leapDay, sizeof(dateTime)) == 0);
+
+	DS1307_FromSecondsSince2000(3155759999u, &dateTime); /* Last second of the calendar */
+	CHECK((dateTime.year == 99) && (dateTime.month == 12) && (dateTime.date == 31) && (dateTime.hours == 23) &&
+		  (dateTime.minutes == 59) && (dateTime.seconds == 59));
+	CHECK_EQUAL(DS1307_FromEpoch(946684799u, &dateTime), STAUS_FAILURE);
+	CHECK_EQUAL(DS1307_FromEpoch(946684800u + 3155760000u, &dateTime), STAUS_FAILURE);
+
+	for(uint32_t seconds = 0; seconds < 3155760000u; seconds += 86399u)
+	{
+		uint8_t regs[DS1307_TIMEKEEPER_REGS_LENGTH];
+		uint8_t bytes[DS1307_TIMESTAMP_SIZE];
+
+		DS1307_FromSecondsSince2000(seconds, &dateTime);
+		CHECK_EQUAL(DS1307_ToSecondsSince2000(&dateTime), seconds);
+		DS1307_TimestampToRegs(seconds, regs);
+		CHECK_EQUAL(DS1307_TimestampFromRegs(regs), seconds);
+		DS1307_TimestampStore(seconds, bytes);
+		CHECK_EQUAL(DS1307_TimestampLoad(bytes), seconds);
+	}
+}
+
+static void Test_MockPowerUp(void)
+{
+	uint8_t regs[DS1307_REG_CONTROL + 1];
+
+	Test_Setup();
+	CHECK_EQUAL(I2C_Dev_Burst_Read(&testRtc, DS1307_REG_SECONDS, regs, sizeof(regs)), STATUS_SUCCESS);
+	CHECK(DS1307_Reg_ClockHalted(regs));
+	CHECK_EQUAL(regs[2], 0x00);
+	CHECK_EQUAL(regs[DS1307_REG_CONTROL], CONTROL_REG_RS_32768HZ);
+}
+
+/* The register pointer wraps from 3Fh to 00h, for writes and reads, and a read without a write continues at the pointer */
+static void Test_PointerWrap(void)
+{
+	const uint8_t data[] = { 0xA1, 0xA2, 0x30, 0x31 };
+	uint8_t buffer[3];
+
+	Test_Setup();
+	CHECK_EQUAL(I2C_Dev_Burst_Write(&testRtc, 0x3E, data, sizeof(data)), STATUS_SUCCESS);
+	CHECK_EQUAL(mock.regs[0x3E], 0xA1);
+	CHECK_EQUAL(mock.regs[0x3F], 0xA2);
+	CHECK_EQUAL(mock.regs[0x00], 0x30);
+	CHECK_EQUAL(mock.regs[0x01], 0x31);
+	CHECK_EQUAL(mock.pointer, 0x02);
+
+	CHECK_EQUAL(I2C_Dev_Burst_Read(&testRtc, 0x3F, buffer, sizeof(buffer)), STATUS_SUCCESS);
+	CHECK_EQUAL(buffer[0], 0xA2);
+	CHECK_EQUAL(buffer[1], 0x30);
+	CHECK_EQUAL(buffer[2], 0x31);
+
+	CHECK_EQUAL(DS1307_Mock_Transfer(&mock, DS1307_I2C_ADDRESS, NULL, 0, buffer, 1), I2C_ERROR_NONE);
+	CHECK_EQUAL(buffer[0], mock.regs[0x02]);
+}
+
+/* Only OUT, SQWE, RS1 and RS0 of the control register can be set */
+static void Test_ControlWriteMask(void)
+{
+	Test_Setup();
+	CHECK_EQUAL(I2C_Dev_Register_Write(&testRtc, DS1307_REG_CONTROL, 0xFF), STATUS_SUCCESS);
+	CHECK_EQUAL(I2C_Dev_Register_Read(&testRtc, DS1307_REG_CONTROL), 0x93);
+	CHECK_EQUAL(mock.regs[DS1307_REG_CONTROL], DS1307_MOCK_CONTROL_WRITE_MASK);
+}
+
+/* The time only counts while CH is clear */
+static void Test_ClockHaltGating(void)
+{
+	DS1307_DateTime_t dateTime;
+	bool halted = false;
+
+	Test_Setup();
+	DS1307_Mock_Tick(&mock, 10);
+	CHECK_EQUAL(mock.regs[0], CH_BIT_REG_0_READ_MASK);
+
+	CHECK_EQUAL(DS1307_Dev_EnableOscillator(&testRtc), STATUS_SUCCESS);
+	CHECK_EQUAL(mock.regs[0], 0x00);
+	DS1307_Mock_Tick(&mock, 61);
+	CHECK_EQUAL(DS1307_Dev_ReadDateTime(&testRtc, &dateTime), STATUS_SUCCESS);
+	CHECK((dateTime.hours == 0) && (dateTime.minutes == 1) && (dateTime.seconds == 1));
+
+	CHECK_EQUAL(DS1307_Dev_HaltOscillator(&testRtc), STATUS_SUCCESS);
+	CHECK_EQUAL(DS1307_Dev_IsOscillatorHalted(&testRtc, &halted), STATUS_SUCCESS);
+	CHECK(halted);
+	DS1307_Mock_Tick(&mock, 5);
+	CHECK_EQUAL(mock.regs[0], CH_BIT_REG_0_READ_MASK | 0x01);
+
+	/* Rollover into a leap day */
+	const DS1307_DateTime_t beforeLeapDay = { .seconds = 59, .minutes = 59, .hours = 23, .dayOfWeek = 4, .date = 28, .month = 2, .year = 24 };
+	CHECK_EQUAL(DS1307_Dev_WriteDateTime(&testRtc, &beforeLeapDay), STATUS_SUCCESS);
+	DS1307_Mock_Tick(&mock, 1);
+	CHECK_EQUAL(DS1307_Dev_ReadDateTime(&testRtc, &dateTime), STATUS_SUCCESS);
+	CHECK((dateTime.date == 29) && (dateTime.month == 2) && (dateTime.hours == 0) && (dateTime.dayOfWeek == 5));
+}
+
+/* Injected address NACKs are retried up to maxRetries, then reported */
+static void Test_NackInjection(void)
+{
+	I2C_Stats_t stats;
+	I2C_Device_t otherSlave = { .bus = &testBus, .address = 0x50, .timing = { 0 } };
+
+	Test_Setup();
+	mock.failNextCount = 2;
+	CHECK_EQUAL(I2C_Dev_Register_Read(&testRtc, DS1307_REG_CONTROL), CONTROL_REG_RS_32768HZ);
+	CHECK_EQUAL(mock.transactionCount, 3);
+	I2C_Bus_GetStats(&testBus, &stats);
+	CHECK_EQUAL(stats.transactions, 1);
+	CHECK_EQUAL(stats.retries, 2);
+	CHECK_EQUAL(stats.errors[I2C_ERROR_ADDRESS_NACK], 2);
+	CHECK_EQUAL(stats.failedTransactions, 0);
+
+	Test_Setup();
+	mock.failNextCount = 100;
+	CHECK_EQUAL(I2C_Dev_Register_Write(&testRtc, DS1307_REG_CONTROL, 0x10), MPU6050_REGISTER_I2C_READ_FAIL);
+	CHECK_EQUAL(I2C_Bus_GetLastError(&testBus, NULL), I2C_ERROR_ADDRESS_NACK);
+	CHECK_EQUAL(mock.transactionCount, 6); /* First attempt + 5 retries */
+	CHECK_EQUAL(mock.regs[DS1307_REG_CONTROL], CONTROL_REG_RS_32768HZ);
+	I2C_Bus_GetStats(&testBus, &stats);
+	CHECK_EQUAL(stats.failedTransactions, 1);
+
+	Test_Setup();
+	CHECK_EQUAL(I2C_Dev_Register_Read(&otherSlave, 0x00), MPU6050_REGISTER_I2C_READ_FAIL);
+	CHECK_EQUAL(I2C_Bus_GetLastError(&testBus, NULL), I2C_ERROR_ADDRESS_NACK);
+
+	I2C_Bus_SetBackend(&testBus, NULL, NULL); /* No controller on the host - like an empty bus */
+	CHECK_EQUAL(I2C_Dev_Register_Read(&testRtc, 0x00), MPU6050_REGISTER_I2C_READ_FAIL);
+}
+
+/* Shadowed control register: writes of the current value and bit updates cost no read */
+static void Test_ControlShadow(void)
+{
+	uint8_t control = 0;
+
+	Test_Setup();
+	CHECK_EQUAL(DS1307_Dev_EnableSquareWaveOutput(&testRtc, CONTROL_REG_RS_4096HZ), STATUS_SUCCESS);
+	CHECK_EQUAL(mock.regs[DS1307_REG_CONTROL], CONTROL_REG_SQWE_BIT | CONTROL_REG_RS_4096HZ);
+	DS1307_Mock_ResetStats(&mock);
+	CHECK_EQUAL(DS1307_Dev_SetControl(&testRtc, CONTROL_REG_SQWE_BIT | CONTROL_REG_RS_4096HZ), STATUS_SUCCESS);
+	CHECK_EQUAL(mock.transactionCount, 0);
+
+	CHECK_EQUAL(DS1307_Dev_SetOutputLevel(&testRtc, true), STATUS_SUCCESS);
+	CHECK_EQUAL(mock.transactionCount, 1);
+	CHECK_EQUAL(mock.regs[DS1307_REG_CONTROL], CONTROL_REG_OUT_BIT | CONTROL_REG_RS_4096HZ); /* RS kept */
+	CHECK_EQUAL(DS1307_Dev_GetControl(&testRtc, &control), STATUS_SUCCESS);
+	CHECK_EQUAL(control, CONTROL_REG_OUT_BIT | CONTROL_REG_RS_4096HZ);
+	CHECK_EQUAL(mock.transactionCount, 1);
+}
+
+/* Bus cost of the common read paths (what the benchmark reports, checked here so it can't regress unnoticed) */
+static void Test_BusCost(void)
+{
+	DS1307_Timestamp_t timestamp;
+	DS1307_DateTime_t dateTime;
+	uint8_t nvram_au8[4];
+
+	Test_Setup();
+	CHECK_EQUAL(DS1307_Dev_ReadTimestamp(&testRtc, &timestamp), STATUS_SUCCESS);
+	CHECK_EQUAL(mock.transactionCount, 1);
+	CHECK_EQUAL(mock.bytesOnBus, 1 + 1 + 1 + DS1307_TIMEKEEPER_REGS_LENGTH); /* Address, pointer, address, data */
+
+	/* Time plus the last 4 NVRAM bytes (3Ch-3Fh) - one read wrapping from 3Fh to 00h */
+	mock.regs[0x3F] = 0x5A;
+	DS1307_Mock_ResetStats(&mock);
+	CHECK_EQUAL(DS1307_Dev_ReadDateTimeAndNVRAM(&testRtc, &dateTime, DS1307_NVRAM_SIZE - 4, nvram_au8, sizeof(nvram_au8)), STATUS_SUCCESS);
+	CHECK_EQUAL(mock.transactionCount, 1);
+	CHECK_EQUAL(mock.bytesOnBus, 3 + DS1307_TIMEKEEPER_REGS_LENGTH + sizeof(nvram_au8));
+	CHECK_EQUAL(nvram_au8[3], 0x5A);
+	CHECK_EQUAL(dateTime.hours, 0);
+}
+
+static void Test_NVRAM(void)
+{
+	const uint8_t data[] = { 1, 2, 3 };
+	uint8_t buffer[3] = { 0 };
+
+	Test_Setup();
+	CHECK_EQUAL(DS1307_Dev_NVRAM_Write(&testRtc, 0, data, sizeof(data)), STATUS_SUCCESS);
+	CHECK_EQUAL(mock.regs[DS1307_NVRAM_START + 2], 3);
+	CHECK_EQUAL(DS1307_Dev_NVRAM_Read(&testRtc, 0, buffer, sizeof(buffer)), STATUS_SUCCESS);
+	CHECK(memcmp(buffer, data, sizeof(data)) == 0);
+	CHECK_EQUAL(DS1307_Dev_NVRAM_Write(&testRtc, DS1307_NVRAM_SIZE - 2, data, sizeof(data)), STAUS_FAILURE);
+	CHECK_EQUAL(DS1307_Dev_NVRAM_Read(&testRtc, 0, buffer, 0), STAUS_FAILURE);
+}
+
+/* Put a record straight into the model's NVRAM - 'validCrc' false gives a torn (half written) slot */
+static void Test_JournalPutSlot(uint8_t slotIndex, uint8_t sequence, uint8_t fill, bool validCrc)
+{
+	const size_t crcOffset = DS1307_JOURNAL_HEADER_SIZE + DS1307_JOURNAL_PAYLOAD_SIZE;
+	uint8_t *slot = &mock.regs[DS1307_NVRAM_START + (slotIndex * DS1307_JOURNAL_SLOT_SIZE)];
+
+	slot[0] = sequence;
+	memset(&slot[DS1307_JOURNAL_HEADER_SIZE], fill, DS1307_JOURNAL_PAYLOAD_SIZE);
+	uint16_t crc = DS1307_Journal_Crc16(slot, crcOffset);
+	if(!validCrc)
+	{
+		crc ^= 0x0001;
+	}
+	slot[crcOffset] = (uint8_t)(crc >> 8);
+	slot[crcOffset + 1] = (uint8_t)crc;
+}
+
+/* Commits alternate between the slots, recovery takes the valid slot with the newer sequence number */
+static void Test_JournalSlots(void)
+{
+	uint8_t payload[DS1307_JOURNAL_PAYLOAD_SIZE];
+	uint8_t recovered[DS1307_JOURNAL_PAYLOAD_SIZE];
+	uint8_t *slot0 = &mock.regs[DS1307_NVRAM_START];
+	uint8_t *slot1 = &mock.regs[DS1307_NVRAM_START + DS1307_JOURNAL_SLOT_SIZE];
+
+	CHECK_EQUAL(DS1307_Journal_Crc16((const uint8_t *)"123456789", 9), 0x29B1); /* CRC-16/CCITT-FALSE check value */
+
+	Test_Setup();
+	CHECK_EQUAL(DS1307_Journal_Recover(recovered), DS1307_JOURNAL_NO_RECORD); /* Power-up NVRAM - no valid slot */
+	CHECK_EQUAL(mock.transactionCount, 1);
+
+	for(uint8_t commit = 1; commit <= 3; commit++)
+	{
+		memset(payload, 0x10 * commit, sizeof(payload));
+		DS1307_Mock_ResetStats(&mock);
+		CHECK_EQUAL(DS1307_Journal_Commit(payload, sizeof(payload)), STATUS_SUCCESS);
+		CHECK_EQUAL(mock.transactionCount, 1);
+		CHECK_EQUAL(mock.bytesOnBus, 1 + 1 + DS1307_JOURNAL_SLOT_SIZE); /* Address, pointer, one slot */
+	}
+	CHECK_EQUAL(slot0[0], 3); /* Commits 1 and 3 */
+	CHECK_EQUAL(slot0[DS1307_JOURNAL_HEADER_SIZE], 0x30);
+	CHECK_EQUAL(slot1[0], 2);
+	CHECK_EQUAL(slot1[DS1307_JOURNAL_HEADER_SIZE], 0x20);
+
+	CHECK_EQUAL(DS1307_Journal_Recover(recovered), STATUS_SUCCESS);
+	CHECK(memcmp(recovered, payload, sizeof(payload)) == 0);
+
+	/* Short payloads are zero-filled */
+	CHECK_EQUAL(DS1307_Journal_Commit(payload, 2), STATUS_SUCCESS);
+	CHECK_EQUAL(slot1[0], 4);
+	CHECK_EQUAL(slot1[DS1307_JOURNAL_HEADER_SIZE + 1], 0x30);
+	CHECK_EQUAL(slot1[DS1307_JOURNAL_HEADER_SIZE + 2], 0x00);
+	CHECK_EQUAL(DS1307_Journal_Commit(payload, DS1307_JOURNAL_PAYLOAD_SIZE + 1), STAUS_FAILURE);
+	CHECK_EQUAL(DS1307_Journal_Commit(NULL, 1), STAUS_FAILURE);
+
+	/* Sequence numbers wrap around - 00h is newer than FFh */
+	Test_JournalPutSlot(0, 0xFF, 0xAA, true);
+	Test_JournalPutSlot(1, 0x00, 0xBB, true);
+	CHECK_EQUAL(DS1307_Journal_Recover(recovered), STATUS_SUCCESS);
+	CHECK_EQUAL(recovered[0], 0xBB);
+	Test_JournalPutSlot(0, 0x01, 0xCC, true);
+	CHECK_EQUAL(DS1307_Journal_Recover(recovered), STATUS_SUCCESS);
+	CHECK_EQUAL(recovered[0], 0xCC);
+}
+
+/* A torn commit (bad CRC) falls back to the older record, and the next commit overwrites the torn slot */
+static void Test_JournalCrcRecovery(void)
+{
+	uint8_t recovered[DS1307_JOURNAL_PAYLOAD_SIZE];
+	const uint8_t payload[] = { 0x42 };
+
+	Test_Setup();
+	Test_JournalPutSlot(0, 7, 0x77, true);
+	Test_JournalPutSlot(1, 8, 0x88, false);
+	CHECK_EQUAL(DS1307_Journal_Recover(recovered), STATUS_SUCCESS);
+	CHECK_EQUAL(recovered[0], 0x77);
+	CHECK_EQUAL(recovered[DS1307_JOURNAL_PAYLOAD_SIZE - 1], 0x77);
+
+	CHECK_EQUAL(DS1307_Journal_Commit(payload, sizeof(payload)), STATUS_SUCCESS);
+	CHECK_EQUAL(mock.regs[DS1307_NVRAM_START + DS1307_JOURNAL_SLOT_SIZE], 8);
+	CHECK_EQUAL(mock.regs[DS1307_NVRAM_START], 7); /* Older record untouched */
+	CHECK_EQUAL(DS1307_Journal_Recover(recovered), STATUS_SUCCESS);
+	CHECK_EQUAL(recovered[0], 0x42);
+
+	/* A corrupted payload byte is caught as well */
+	mock.regs[DS1307_NVRAM_START + DS1307_JOURNAL_SLOT_SIZE + DS1307_JOURNAL_HEADER_SIZE + 5] ^= 0x04;
+	CHECK_EQUAL(DS1307_Journal_Recover(recovered), STATUS_SUCCESS);
+	CHECK_EQUAL(recovered[0], 0x77);
+
+	Test_JournalPutSlot(0, 7, 0x77, false);
+	CHECK_EQUAL(DS1307_Journal_Recover(recovered), DS1307_JOURNAL_NO_RECORD);
+	CHECK_EQUAL(DS1307_Journal_Commit(payload, sizeof(payload)), STATUS_SUCCESS); /* Starts over in slot 0 */
+	CHECK_EQUAL(mock.regs[DS1307_NVRAM_START], 1);
+	CHECK_EQUAL(DS1307_Journal_Recover(recovered), STATUS_SUCCESS);
+	CHECK_EQUAL(recovered[0], 0x42);
+
+	mock.failNextCount = 100;
+	CHECK_EQUAL(DS1307_Journal_Recover(recovered), MPU6050_REGISTER_I2C_READ_FAIL);
+	mock.failNextCount = 0;
+}
+
+/* Only dirty bytes are written, runs separated by up to DS1307_NVRAM_CACHE_MERGE_GAP clean bytes in one transaction */
+static void Test_NVRAMCacheFlush(void)
+{
+	const uint8_t one[] = { 0x01 };
+	const uint8_t two[] = { 0x02 };
+	uint8_t buffer[DS1307_NVRAM_SIZE];
+
+	Test_Setup();
+	for(uint8_t i = 0; i < DS1307_NVRAM_SIZE; i++)
+	{
+		mock.regs[DS1307_NVRAM_START + i] = (uint8_t)(0x80 + i);
+	}
+	CHECK_EQUAL(DS1307_NVRAMCache_Load(), STATUS_SUCCESS);
+	CHECK_EQUAL(mock.transactionCount, 1);
+	CHECK(!DS1307_NVRAMCache_IsDirty());
+	CHECK_EQUAL(DS1307_NVRAMCache_Read(0, buffer, sizeof(buffer)), STATUS_SUCCESS);
+	CHECK(memcmp(buffer, &mock.regs[DS1307_NVRAM_START], sizeof(buffer)) == 0);
+
+	/* Reads and unchanged writes stay in RAM */
+	DS1307_Mock_ResetStats(&mock);
+	CHECK_EQUAL(DS1307_NVRAMCache_Write(0, buffer, sizeof(buffer)), STATUS_SUCCESS);
+	CHECK(!DS1307_NVRAMCache_IsDirty());
+	CHECK_EQUAL(DS1307_NVRAMCache_Flush(), STATUS_SUCCESS);
+	CHECK_EQUAL(mock.transactionCount, 0);
+
+	/* 2 and 4 merge (one clean byte between), 20 is a run of its own */
+	CHECK_EQUAL(DS1307_NVRAMCache_Write(2, one, sizeof(one)), STATUS_SUCCESS);
+	CHECK_EQUAL(DS1307_NVRAMCache_Write(4, one, sizeof(one)), STATUS_SUCCESS);
+	CHECK_EQUAL(DS1307_NVRAMCache_Write(20, two, sizeof(two)), STATUS_SUCCESS);
+	CHECK(DS1307_NVRAMCache_IsDirty());
+	CHECK_EQUAL(mock.regs[DS1307_NVRAM_START + 2], 0x82); /* Not written yet */
+	CHECK_EQUAL(DS1307_NVRAMCache_Read(2, buffer, 3), STATUS_SUCCESS);
+	CHECK((buffer[0] == 0x01) && (buffer[1] == 0x83) && (buffer[2] == 0x01));
+	CHECK_EQUAL(DS1307_NVRAMCache_Flush(), STATUS_SUCCESS);
+	CHECK_EQUAL(mock.transactionCount, 2);
+	CHECK_EQUAL(mock.bytesOnBus, (2 + 3) + (2 + 1)); /* Address and pointer + data, per run */
+	CHECK_EQUAL(mock.regs[DS1307_NVRAM_START + 2], 0x01);
+	CHECK_EQUAL(mock.regs[DS1307_NVRAM_START + 3], 0x83);
+	CHECK_EQUAL(mock.regs[DS1307_NVRAM_START + 4], 0x01);
+	CHECK_EQUAL(mock.regs[DS1307_NVRAM_START + 20], 0x02);
+	CHECK(!DS1307_NVRAMCache_IsDirty());
+
+	/* Gap of exactly the merge limit - one run, one byte more - two */
+	DS1307_Mock_ResetStats(&mock);
+	CHECK_EQUAL(DS1307_NVRAMCache_Write(10, two, sizeof(two)), STATUS_SUCCESS);
+	CHECK_EQUAL(DS1307_NVRAMCache_Write(10 + DS1307_NVRAM_CACHE_MERGE_GAP + 1, two, sizeof(two)), STATUS_SUCCESS);
+	CHECK_EQUAL(DS1307_NVRAMCache_Flush(), STATUS_SUCCESS);
+	CHECK_EQUAL(mock.transactionCount, 1);
+	CHECK_EQUAL(mock.bytesOnBus, 2 + DS1307_NVRAM_CACHE_MERGE_GAP + 2);
+
+	DS1307_Mock_ResetStats(&mock);
+	CHECK_EQUAL(DS1307_NVRAMCache_Write(30, one, sizeof(one)), STATUS_SUCCESS);
+	CHECK_EQUAL(DS1307_NVRAMCache_Write(30 + DS1307_NVRAM_CACHE_MERGE_GAP + 2, one, sizeof(one)), STATUS_SUCCESS);
+	CHECK_EQUAL(DS1307_NVRAMCache_Write(DS1307_NVRAM_SIZE - 1, one, sizeof(one)), STATUS_SUCCESS);
+	CHECK_EQUAL(DS1307_NVRAMCache_Flush(), STATUS_SUCCESS);
+	CHECK_EQUAL(mock.transactionCount, 3);
+	CHECK_EQUAL(mock.bytesOnBus, 3 * (2 + 1));
+	CHECK_EQUAL(mock.regs[DS1307_NVRAM_START + DS1307_NVRAM_SIZE - 1], 0x01);
+	CHECK_EQUAL(mock.regs[0], CH_BIT_REG_0_READ_MASK); /* Nothing wrapped into the timekeeper registers */
+
+	/* A failed write keeps its bytes dirty for the next flush */
+	CHECK_EQUAL(DS1307_NVRAMCache_Write(40, two, sizeof(two)), STATUS_SUCCESS);
+	mock.failNextCount = 100;
+	CHECK_EQUAL(DS1307_NVRAMCache_Flush(), MPU6050_REGISTER_I2C_READ_FAIL);
+	CHECK(DS1307_NVRAMCache_IsDirty());
+	mock.failNextCount = 0;
+	CHECK_EQUAL(DS1307_NVRAMCache_Flush(), STATUS_SUCCESS);
+	CHECK(!DS1307_NVRAMCache_IsDirty());
+	CHECK_EQUAL(mock.regs[DS1307_NVRAM_START + 40], 0x02);
+
+	CHECK_EQUAL(DS1307_NVRAMCache_Write(DS1307_NVRAM_SIZE - 1, buffer, 2), STAUS_FAILURE);
+	CHECK_EQUAL(DS1307_NVRAMCache_Read(DS1307_NVRAM_SIZE, buffer, 1), STAUS_FAILURE);
+}
+
+#define TEST_ALARM_MAX_FIRED	256
+
+static uint32_t alarmFiredDue[TEST_ALARM_MAX_FIRED];
+static uint32_t alarmFiredCount = 0;
+
+/* Context - the due time the alarm was added with */
+static void Test_AlarmCallback(int32_t alarmId, uint32_t secondsSince2000, void *context)
+{
+	if(alarmFiredCount < TEST_ALARM_MAX_FIRED)
+	{
+		alarmFiredDue[alarmFiredCount++] = *(const uint32_t *)context;
+	}
+}
+
+static bool Test_AlarmFiredInOrder(void)
+{
+	for(uint32_t i = 1; i < alarmFiredCount; i++)
+	{
+		if(alarmFiredDue[i] < alarmFiredDue[i - 1])
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/* Alarms fire in due order, whatever order they were added or cancelled in */
+static void Test_AlarmOrdering(void)
+{
+	static uint32_t dues[200];
+	static int32_t manyIds[200];
+	static const uint32_t fewDues[] = { 50, 10, 40, 20, 30, 10, 5 };
+	int32_t ids[sizeof(fewDues) / sizeof(fewDues[0])];
+	uint32_t random = 12345;
+
+	alarmFiredCount = 0;
+	for(uint32_t i = 0; i < (sizeof(fewDues) / sizeof(fewDues[0])); i++)
+	{
+		ids[i] = DS1307_Alarm_Add(fewDues[i], DS1307_ALARM_ONE_SHOT, Test_AlarmCallback, (void *)&fewDues[i]);
+		CHECK(ids[i] != DS1307_ALARM_INVALID_ID);
+	}
+	CHECK_EQUAL(DS1307_Alarm_Count(), 7);
+	DS1307_Alarm_Tick(4);
+	CHECK_EQUAL(alarmFiredCount, 0);
+	DS1307_Alarm_Tick(20);
+	CHECK_EQUAL(alarmFiredCount, 4);
+	CHECK((alarmFiredDue[0] == 5) && (alarmFiredDue[1] == 10) && (alarmFiredDue[2] == 10) && (alarmFiredDue[3] == 20));
+
+	CHECK_EQUAL(DS1307_Alarm_Cancel(ids[4]), STATUS_SUCCESS); /* 30 - from the middle of the heap */
+	CHECK_EQUAL(DS1307_Alarm_Cancel(ids[4]), STAUS_FAILURE);
+	CHECK_EQUAL(DS1307_Alarm_Cancel(ids[1]), STAUS_FAILURE); /* Already fired */
+	DS1307_Alarm_Tick(100);
+	CHECK_EQUAL(alarmFiredCount, 6);
+	CHECK((alarmFiredDue[4] == 40) && (alarmFiredDue[5] == 50));
+	CHECK_EQUAL(DS1307_Alarm_Count(), 0);
+
+	/* Periodic alarms are re-inserted at due + period */
+	static const uint32_t periodicDue = 10;
+	static const uint32_t oneShotDue = 12;
+	alarmFiredCount = 0;
+	int32_t periodicId = DS1307_Alarm_Add(periodicDue, 5, Test_AlarmCallback, (void *)&periodicDue);
+	DS1307_Alarm_Add(oneShotDue, DS1307_ALARM_ONE_SHOT, Test_AlarmCallback, (void *)&oneShotDue);
+	DS1307_Alarm_Tick(10);
+	DS1307_Alarm_Tick(15);
+	CHECK_EQUAL(alarmFiredCount, 3);
+	CHECK((alarmFiredDue[0] == periodicDue) && (alarmFiredDue[1] == oneShotDue) && (alarmFiredDue[2] == periodicDue));
+	DS1307_Alarm_Tick(100); /* Missed periods fire once */
+	CHECK_EQUAL(alarmFiredCount, 4);
+	CHECK_EQUAL(DS1307_Alarm_Cancel(periodicId), STATUS_SUCCESS);
+	CHECK_EQUAL(DS1307_Alarm_Count(), 0);
+
+	/* Many alarms in pseudo-random order, some cancelled */
+	alarmFiredCount = 0;
+	for(uint32_t i = 0; i < (sizeof(dues) / sizeof(dues[0])); i++)
+	{
+		random = (random * 1103515245u) + 12345u;
+		dues[i] = 1000 + ((random >> 16) % 5000);
+		manyIds[i] = DS1307_Alarm_Add(dues[i], DS1307_ALARM_ONE_SHOT, Test_AlarmCallback, &dues[i]);
+		CHECK(manyIds[i] != DS1307_ALARM_INVALID_ID);
+	}
+	for(uint32_t i = 0; i < 20; i++)
+	{
+		CHECK_EQUAL(DS1307_Alarm_Cancel(manyIds[i * 3]), STATUS_SUCCESS);
+	}
+	DS1307_Alarm_Tick(3500);
+	DS1307_Alarm_Tick(10000);
+	CHECK_EQUAL(alarmFiredCount, (sizeof(dues) / sizeof(dues[0])) - 20);
+	CHECK(Test_AlarmFiredInOrder());
+	CHECK_EQUAL(DS1307_Alarm_Count(), 0);
+}
+
+int main(void)
+{
+	Test_Bcd();
+	Test_Hours();
+	Test_DecodeValidated();
+	Test_DateConversion();
+	Test_MockPowerUp();
+	Test_PointerWrap();
+	Test_ControlWriteMask();
+	Test_ClockHaltGating();
+	Test_NackInjection();
+	Test_ControlShadow();
+	Test_BusCost();
+	Test_NVRAM();
+	Test_JournalSlots();
+	Test_JournalCrcRecovery();
+	Test_NVRAMCacheFlush();
+	Test_AlarmOrdering();
+
+	printf("%lu checks, %lu failed\n", (unsigned long)checkCount, (unsigned long)failureCount);
+	return (failureCount == 0) ? 0 : 1;
+}
@@ -0,0 +1,29 @@
+/**
+ * Controller part of the I2C driver for the host build - there is no DW_apb_i2c on a PC. Stands in for the 
+ * functions of I2C_Driver.c the transaction layer (I2C_Transaction.c) calls: a bus without a backend 
+ * (I2C_Bus_SetBackend()) behaves like a bus without any slave on it.
+*/
+
+#include "DS1307_HAL.h"
+#include "I2C_Driver.h"
+
+void I2C_Dev_Select(I2C_Device_t *device)
+{
+	(void)device;
+}
+
+uint8_t I2C_Bus_TransferAttempt(I2C_Bus_t *bus, const uint8_t *txData, size_t txLength, uint8_t *rxData, size_t rxLength)
+{
+	(void)txData;
+	(void)txLength;
+	(void)rxData;
+	(void)rxLength;
+
+	bus->lastAbortSource = 0;
+	return I2C_ERROR_ADDRESS_NACK;
+}
+
+void I2C_Bus_Recovery(I2C_Bus_t *bus)
+{
+	(void)bus;
+}